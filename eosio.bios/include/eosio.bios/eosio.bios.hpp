@@ -75,6 +75,53 @@ namespace eosio {
          };
 
          typedef eosio::multi_index< "abihash"_n, abi_hash > abi_hash_table;
+
+         struct priv_update {
+            name      account;
+            uint8_t   is_priv;
+
+            EOSLIB_SERIALIZE( priv_update, (account)(is_priv) )
+         };
+
+         struct limits_update {
+            name      account;
+            int64_t   ram_bytes;
+            int64_t   net_weight;
+            int64_t   cpu_weight;
+
+            EOSLIB_SERIALIZE( limits_update, (account)(ram_bytes)(net_weight)(cpu_weight) )
+         };
+
+         /**
+          * Applies many setpriv, setalimits and abi hash updates in a single action,
+          * used to bring up a fully configured chain without a transaction per update.
+          */
+         [[eosio::action]]
+         void bootstrap( const std::vector<priv_update>& privs, const std::vector<limits_update>& limits,
+                         const std::vector<abi_hash>& abi_hashes ) {
+            require_auth( _self );
+
+            for( const auto& p : privs ) {
+               set_privileged( p.account.value, p.is_priv );
+            }
+            for( const auto& l : limits ) {
+               set_resource_limits( l.account.value, l.ram_bytes, l.net_weight, l.cpu_weight );
+            }
+
+            abi_hash_table table(_self, _self.value);
+            for( const auto& h : abi_hashes ) {
+               auto itr = table.find( h.owner.value );
+               if( itr == table.end() ) {
+                  table.emplace( _self, [&]( auto& row ) {
+                     row = h;
+                  });
+               } else {
+                  table.modify( itr, same_payer, [&]( auto& row ) {
+                     row.hash = h.hash;
+                  });
+               }
+            }
+         }
    };
 
 } /// namespace eosio
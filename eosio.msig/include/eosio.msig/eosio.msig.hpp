@@ -9,6 +9,11 @@ namespace eosio {
       public:
          using contract::contract;
 
+         struct proposal_id {
+            name   proposer;
+            name   proposal_name;
+         };
+
          [[eosio::action]]
          void propose(ignore<name> proposer, ignore<name> proposal_name,
                ignore<std::vector<permission_level>> requested, ignore<transaction> trx);
@@ -16,18 +21,38 @@ namespace eosio {
          void approve( name proposer, name proposal_name, permission_level level,
                        const eosio::binary_extension<eosio::checksum256>& proposal_hash );
          [[eosio::action]]
+         void approvebatch( permission_level level, const std::vector<proposal_id>& proposals );
+         [[eosio::action]]
          void unapprove( name proposer, name proposal_name, permission_level level );
          [[eosio::action]]
          void cancel( name proposer, name proposal_name, name canceler );
          [[eosio::action]]
-         void exec( name proposer, name proposal_name, name executer );
+         void exec( name proposer, name proposal_name, name executer,
+                    const eosio::binary_extension<bool>& immediate );
          [[eosio::action]]
          void invalidate( name account );
 
+         [[eosio::action]]
+         void beginblob( name uploader, eosio::checksum256 blob_hash, uint32_t size );
+         [[eosio::action]]
+         void appendblob( name uploader, eosio::checksum256 blob_hash, uint32_t offset, const std::vector<char>& data );
+         [[eosio::action]]
+         void finalizeblob( name uploader, eosio::checksum256 blob_hash );
+         [[eosio::action]]
+         void cancelblob( name uploader, eosio::checksum256 blob_hash );
+         [[eosio::action]]
+         void proposeblob( name proposer, name proposal_name, std::vector<permission_level> requested,
+                           eosio::checksum256 trx_hash );
+         [[eosio::action]]
+         void cleanup( uint32_t max_rows );
+         [[eosio::action]]
+         void index( name proposer, name proposal_name, name payer );
+
       private:
          struct [[eosio::table]] proposal {
-            name                            proposal_name;
-            std::vector<char>               packed_transaction;
+            name                                        proposal_name;
+            std::vector<char>                           packed_transaction;
+            eosio::binary_extension<eosio::checksum256> trx_hash; ///< sha256 of packed_transaction, absent in rows created by older versions
 
             uint64_t primary_key()const { return proposal_name.value; }
          };
@@ -69,6 +94,82 @@ namespace eosio {
          };
 
          typedef eosio::multi_index< "invals"_n, invalidation > invalidations;
+
+         /// finalized packed transaction, shared by all proposals created with proposeblob
+         struct [[eosio::table]] blob {
+            uint64_t             id;
+            eosio::checksum256   hash;
+            name                 uploader;
+            uint32_t             size = 0;
+            uint32_t             references = 0;
+
+            uint64_t primary_key()const { return id; }
+            eosio::checksum256 by_hash()const { return hash; }
+         };
+
+         typedef eosio::multi_index< "blobs"_n, blob,
+                                     indexed_by<"byhash"_n, const_mem_fun<blob, eosio::checksum256, &blob::by_hash>  >
+                                   > blobs;
+
+         /// contents of a finalized blob, kept apart from the blob row so that reference counting doesn't rewrite it
+         struct [[eosio::table]] blob_data {
+            uint64_t            id;
+            std::vector<char>   data;
+
+            uint64_t primary_key()const { return id; }
+         };
+
+         typedef eosio::multi_index< "blobdata"_n, blob_data > blob_datas;
+
+         /// blob being uploaded, scoped by uploader so that nobody else can hold on to its hash before it is finalized
+         struct [[eosio::table]] upload {
+            uint64_t             id;
+            eosio::checksum256   hash;
+            uint32_t             size = 0;
+            uint32_t             uploaded = 0;
+
+            uint64_t primary_key()const { return id; }
+            eosio::checksum256 by_hash()const { return hash; }
+         };
+
+         typedef eosio::multi_index< "uploads"_n, upload,
+                                     indexed_by<"byhash"_n, const_mem_fun<upload, eosio::checksum256, &upload::by_hash>  >
+                                   > uploads;
+
+         /// chunk of an upload, scoped by uploader
+         struct [[eosio::table]] blob_chunk {
+            uint64_t            upload_id;
+            uint32_t            offset;
+            std::vector<char>   data;
+
+            uint64_t primary_key()const { return (upload_id << 32) | offset; }
+         };
+
+         typedef eosio::multi_index< "blobchunks"_n, blob_chunk > blob_chunks;
+
+         /// expiration of a proposal, lets cleanup find expired proposals of all proposers without unpacking them
+         struct [[eosio::table]] proposal_expiration {
+            uint64_t         id;
+            name             proposer;
+            name             proposal_name;
+            time_point_sec   expiration;
+
+            uint64_t  primary_key()const { return id; }
+            uint64_t  by_expiration()const { return expiration.utc_seconds; }
+            uint128_t by_proposal()const { return (uint128_t(proposer.value) << 64) | proposal_name.value; }
+         };
+
+         typedef eosio::multi_index< "expirations"_n, proposal_expiration,
+                                     indexed_by<"byexpiry"_n, const_mem_fun<proposal_expiration, uint64_t, &proposal_expiration::by_expiration>  >,
+                                     indexed_by<"byproposal"_n, const_mem_fun<proposal_expiration, uint128_t, &proposal_expiration::by_proposal>  >
+                                   > expirations;
+
+         void add_approval( name proposer, name proposal_name, const permission_level& level );
+         void release_blob( const eosio::checksum256& hash );
+         void erase_chunks( name uploader, uint64_t upload_id );
+         void add_expiration( name payer, name proposer, name proposal_name, time_point_sec expiration );
+         void remove_expiration( name proposer, name proposal_name );
+         void erase_proposal( proposals& proptable, const proposal& prop, name proposer );
    };
 
 } /// namespace eosio
@@ -40,12 +40,10 @@ void multisig::propose( ignore<name> proposer,
                                                );
    eosio_assert( res > 0, "transaction authorization failed" );
 
-   std::vector<char> pkd_trans;
-   pkd_trans.resize(size);
-   memcpy((char*)pkd_trans.data(), trx_pos, size);
    proptable.emplace( _proposer, [&]( auto& prop ) {
       prop.proposal_name       = _proposal_name;
-      prop.packed_transaction  = pkd_trans;
+      prop.packed_transaction.assign( trx_pos, trx_pos + size );
+      prop.trx_hash.emplace( sha256( trx_pos, size ) );
    });
 
    approvals apptable(  _self, _proposer.value );
@@ -56,6 +54,8 @@ void multisig::propose( ignore<name> proposer,
          a.requested_approvals.push_back( approval{ level, time_point{ microseconds{0} } } );
       }
    });
+
+   add_expiration( _proposer, _proposer, _proposal_name, _trx_header.expiration );
 }
 
 void multisig::approve( name proposer, name proposal_name, permission_level level,
@@ -66,9 +66,26 @@ void multisig::approve( name proposer, name proposal_name, permission_level leve
    if( proposal_hash ) {
       proposals proptable( _self, proposer.value );
       auto& prop = proptable.get( proposal_name.value, "proposal not found" );
-      assert_sha256( prop.packed_transaction.data(), prop.packed_transaction.size(), *proposal_hash );
+      // a matching stored digest saves rehashing, proposals created by older versions of the contract and mismatches
+      // are hashed so that approve fails with the same crypto_api_exception as before the digest was stored
+      if( !prop.trx_hash || *prop.trx_hash != *proposal_hash ) {
+         assert_sha256( prop.packed_transaction.data(), prop.packed_transaction.size(), *proposal_hash );
+      }
+   }
+
+   add_approval( proposer, proposal_name, level );
+}
+
+void multisig::approvebatch( permission_level level, const std::vector<proposal_id>& proposals ) {
+   require_auth( level );
+   eosio_assert( proposals.size() > 0, "no proposals to approve" );
+
+   for( const auto& p : proposals ) {
+      add_approval( p.proposer, p.proposal_name, level );
    }
+}
 
+void multisig::add_approval( name proposer, name proposal_name, const permission_level& level ) {
    approvals apptable(  _self, proposer.value );
    auto apps_it = apptable.find( proposal_name.value );
    if ( apps_it != apptable.end() ) {
@@ -122,32 +139,49 @@ void multisig::cancel( name proposer, name proposal_name, name canceler ) {
 
    proposals proptable( _self, proposer.value );
    auto& prop = proptable.get( proposal_name.value, "proposal not found" );
+   // proposals created with proposeblob keep the transaction in the shared blob
+   const bool uses_blob = prop.packed_transaction.empty();
 
    if( canceler != proposer ) {
-      eosio_assert( unpack<transaction_header>( prop.packed_transaction ).expiration < eosio::time_point_sec(current_time_point()), "cannot cancel until expiration" );
-   }
-   proptable.erase(prop);
-
-   //remove from new table
-   approvals apptable(  _self, proposer.value );
-   auto apps_it = apptable.find( proposal_name.value );
-   if ( apps_it != apptable.end() ) {
-      apptable.erase(apps_it);
-   } else {
-      old_approvals old_apptable(  _self, proposer.value );
-      auto apps_it = old_apptable.find( proposal_name.value );
-      eosio_assert( apps_it != old_apptable.end(), "proposal not found" );
-      old_apptable.erase(apps_it);
+      transaction_header trx_header;
+      if( uses_blob ) {
+         blobs blobtable( _self, _self.value );
+         blob_datas datatable( _self, _self.value );
+         auto blob_idx = blobtable.get_index<"byhash"_n>();
+         auto blob_it = blob_idx.find( *prop.trx_hash );
+         eosio_assert( blob_it != blob_idx.end(), "blob not found" );
+         trx_header = unpack<transaction_header>( datatable.get( blob_it->id, "blob not found" ).data );
+      } else {
+         trx_header = unpack<transaction_header>( prop.packed_transaction );
+      }
+      eosio_assert( trx_header.expiration < eosio::time_point_sec(current_time_point()), "cannot cancel until expiration" );
    }
+   erase_proposal( proptable, prop, proposer );
+   remove_expiration( proposer, proposal_name );
 }
 
-void multisig::exec( name proposer, name proposal_name, name executer ) {
+void multisig::exec( name proposer, name proposal_name, name executer,
+                     const eosio::binary_extension<bool>& immediate )
+{
    require_auth( executer );
 
    proposals proptable( _self, proposer.value );
    auto& prop = proptable.get( proposal_name.value, "proposal not found" );
+
+   // point at the stored transaction instead of copying it, large blobs can be hundreds of kilobytes
+   const std::vector<char>* packed_trx = &prop.packed_transaction;
+   const bool uses_blob = packed_trx->empty();
+   blob_datas datatable( _self, _self.value );
+   if( uses_blob ) {
+      blobs blobtable( _self, _self.value );
+      auto blob_idx = blobtable.get_index<"byhash"_n>();
+      auto blob_it = blob_idx.find( *prop.trx_hash );
+      eosio_assert( blob_it != blob_idx.end(), "blob not found" );
+      packed_trx = &datatable.get( blob_it->id, "blob not found" ).data;
+   }
+
    transaction_header trx_header;
-   datastream<const char*> ds( prop.packed_transaction.data(), prop.packed_transaction.size() );
+   datastream<const char*> ds( packed_trx->data(), packed_trx->size() );
    ds >> trx_header;
    eosio_assert( trx_header.expiration >= eosio::time_point_sec(current_time_point()), "transaction expired" );
 
@@ -176,16 +210,30 @@ void multisig::exec( name proposer, name proposal_name, name executer ) {
       old_apptable.erase(apps);
    }
    auto packed_provided_approvals = pack(approvals);
-   auto res = ::check_transaction_authorization( prop.packed_transaction.data(), prop.packed_transaction.size(),
+   auto res = ::check_transaction_authorization( packed_trx->data(), packed_trx->size(),
                                                  (const char*)0, 0,
                                                  packed_provided_approvals.data(), packed_provided_approvals.size()
                                                  );
    eosio_assert( res > 0, "transaction authorization failed" );
 
-   send_deferred( (uint128_t(proposer.value) << 64) | proposal_name.value, executer.value,
-                  prop.packed_transaction.data(), prop.packed_transaction.size() );
+   if( immediate && *immediate ) {
+      // dispatch the actions inline within this transaction instead of scheduling a deferred one
+      eosio_assert( trx_header.delay_sec.value == 0, "immediate execution requires a transaction without delay" );
+      auto trx = unpack<transaction>( *packed_trx );
+      eosio_assert( trx.context_free_actions.empty(), "immediate execution doesn't support context-free actions" );
+      for( const auto& act : trx.actions ) {
+         act.send();
+      }
+   } else {
+      send_deferred( (uint128_t(proposer.value) << 64) | proposal_name.value, executer.value,
+                     packed_trx->data(), packed_trx->size() );
+   }
 
+   if( uses_blob ) {
+      release_blob( *prop.trx_hash );
+   }
    proptable.erase(prop);
+   remove_expiration( proposer, proposal_name );
 }
 
 void multisig::invalidate( name account ) {
@@ -204,6 +252,261 @@ void multisig::invalidate( name account ) {
    }
 }
 
+void multisig::beginblob( name uploader, eosio::checksum256 blob_hash, uint32_t size ) {
+   require_auth( uploader );
+   eosio_assert( size > 0, "blob must not be empty" );
+
+   blobs blobtable( _self, _self.value );
+   auto blob_idx = blobtable.get_index<"byhash"_n>();
+   eosio_assert( blob_idx.find( blob_hash ) == blob_idx.end(), "blob with the same hash exists" );
+
+   uploads uptable( _self, uploader.value );
+   auto up_idx = uptable.get_index<"byhash"_n>();
+   eosio_assert( up_idx.find( blob_hash ) == up_idx.end(), "upload with the same hash exists" );
+
+   uptable.emplace( uploader, [&]( auto& u ) {
+      u.id   = uptable.available_primary_key();
+      u.hash = blob_hash;
+      u.size = size;
+   });
+}
+
+void multisig::appendblob( name uploader, eosio::checksum256 blob_hash, uint32_t offset, const std::vector<char>& data ) {
+   require_auth( uploader );
+   eosio_assert( data.size() > 0, "chunk must not be empty" );
+
+   uploads uptable( _self, uploader.value );
+   auto up_idx = uptable.get_index<"byhash"_n>();
+   auto up_it = up_idx.find( blob_hash );
+   eosio_assert( up_it != up_idx.end(), "upload not found" );
+   eosio_assert( offset == up_it->uploaded, "chunk offset doesn't match uploaded size" );
+   eosio_assert( data.size() <= up_it->size - up_it->uploaded, "chunk exceeds blob size" );
+
+   blob_chunks chunktable( _self, uploader.value );
+   chunktable.emplace( uploader, [&]( auto& c ) {
+      c.upload_id = up_it->id;
+      c.offset    = offset;
+      c.data      = data;
+   });
+   up_idx.modify( up_it, same_payer, [&]( auto& u ) {
+      u.uploaded += data.size();
+   });
+}
+
+void multisig::finalizeblob( name uploader, eosio::checksum256 blob_hash ) {
+   require_auth( uploader );
+
+   uploads uptable( _self, uploader.value );
+   auto up_idx = uptable.get_index<"byhash"_n>();
+   auto up_it = up_idx.find( blob_hash );
+   eosio_assert( up_it != up_idx.end(), "upload not found" );
+   eosio_assert( up_it->uploaded == up_it->size, "blob upload is incomplete" );
+
+   // the chunks are joined into one buffer to check the hash, which is then moved into the stored row
+   std::vector<char> data( up_it->size );
+   blob_chunks chunktable( _self, uploader.value );
+   for( auto chunk_it = chunktable.lower_bound( up_it->id << 32 ); chunk_it != chunktable.end() && chunk_it->upload_id == up_it->id; ) {
+      memcpy( data.data() + chunk_it->offset, chunk_it->data.data(), chunk_it->data.size() );
+      chunk_it = chunktable.erase( chunk_it );
+   }
+   assert_sha256( data.data(), data.size(), blob_hash );
+   up_idx.erase( up_it );
+
+   blobs blobtable( _self, _self.value );
+   auto blob_idx = blobtable.get_index<"byhash"_n>();
+   if( blob_idx.find( blob_hash ) != blob_idx.end() ) {
+      // somebody else finalized the same transaction first, proposals can use theirs
+      return;
+   }
+   const uint64_t id   = blobtable.available_primary_key();
+   const uint32_t size = data.size();
+   blob_datas datatable( _self, _self.value );
+   datatable.emplace( uploader, [&]( auto& d ) {
+      d.id   = id;
+      d.data = std::move( data );
+   });
+   blobtable.emplace( uploader, [&]( auto& b ) {
+      b.id       = id;
+      b.hash     = blob_hash;
+      b.uploader = uploader;
+      b.size     = size;
+   });
+}
+
+void multisig::cancelblob( name uploader, eosio::checksum256 blob_hash ) {
+   require_auth( uploader );
+
+   uploads uptable( _self, uploader.value );
+   auto up_idx = uptable.get_index<"byhash"_n>();
+   auto up_it = up_idx.find( blob_hash );
+   if( up_it != up_idx.end() ) {
+      erase_chunks( uploader, up_it->id );
+      up_idx.erase( up_it );
+      return;
+   }
+
+   blobs blobtable( _self, _self.value );
+   auto blob_idx = blobtable.get_index<"byhash"_n>();
+   auto blob_it = blob_idx.find( blob_hash );
+   eosio_assert( blob_it != blob_idx.end(), "blob not found" );
+   eosio_assert( blob_it->uploader == uploader, "blob belongs to another uploader" );
+   eosio_assert( blob_it->references == 0, "blob is referenced by proposals" );
+
+   blob_datas datatable( _self, _self.value );
+   auto data_it = datatable.find( blob_it->id );
+   if( data_it != datatable.end() ) {
+      datatable.erase( data_it );
+   }
+   blob_idx.erase( blob_it );
+}
+
+void multisig::proposeblob( name proposer, name proposal_name, std::vector<permission_level> requested,
+                            eosio::checksum256 trx_hash )
+{
+   require_auth( proposer );
+
+   blobs blobtable( _self, _self.value );
+   auto blob_idx = blobtable.get_index<"byhash"_n>();
+   auto blob_it = blob_idx.find( trx_hash );
+   eosio_assert( blob_it != blob_idx.end(), "blob not found" );
+   blob_datas datatable( _self, _self.value );
+   const auto& packed_trx = datatable.get( blob_it->id, "blob not found" ).data;
+
+   auto trx_header = unpack<transaction_header>( packed_trx );
+   eosio_assert( trx_header.expiration >= eosio::time_point_sec(current_time_point()), "transaction expired" );
+
+   proposals proptable( _self, proposer.value );
+   eosio_assert( proptable.find( proposal_name.value ) == proptable.end(), "proposal with the same name exists" );
+
+   auto packed_requested = pack(requested);
+   auto res = ::check_transaction_authorization( packed_trx.data(), packed_trx.size(),
+                                                 (const char*)0, 0,
+                                                 packed_requested.data(), packed_requested.size()
+                                               );
+   eosio_assert( res > 0, "transaction authorization failed" );
+
+   // empty packed_transaction marks a proposal backed by the blob with trx_hash
+   proptable.emplace( proposer, [&]( auto& prop ) {
+      prop.proposal_name = proposal_name;
+      prop.trx_hash.emplace( trx_hash );
+   });
+   blob_idx.modify( blob_it, same_payer, [&]( auto& b ) {
+      ++b.references;
+   });
+
+   approvals apptable(  _self, proposer.value );
+   apptable.emplace( proposer, [&]( auto& a ) {
+      a.proposal_name       = proposal_name;
+      a.requested_approvals.reserve( requested.size() );
+      for ( auto& level : requested ) {
+         a.requested_approvals.push_back( approval{ level, time_point{ microseconds{0} } } );
+      }
+   });
+
+   add_expiration( proposer, proposer, proposal_name, trx_header.expiration );
+}
+
+void multisig::cleanup( uint32_t max_rows ) {
+   eosio_assert( max_rows > 0, "max_rows must be positive" );
+
+   const uint64_t now = eosio::time_point_sec(current_time_point()).utc_seconds;
+   expirations exptable( _self, _self.value );
+   auto exp_idx = exptable.get_index<"byexpiry"_n>();
+   uint32_t erased = 0;
+   for( auto exp_it = exp_idx.begin(); exp_it != exp_idx.end() && exp_it->expiration.utc_seconds < now && erased < max_rows; ++erased ) {
+      proposals proptable( _self, exp_it->proposer.value );
+      auto prop_it = proptable.find( exp_it->proposal_name.value );
+      if( prop_it != proptable.end() ) {
+         erase_proposal( proptable, *prop_it, exp_it->proposer );
+      }
+      exp_it = exp_idx.erase( exp_it );
+   }
+   eosio_assert( erased > 0, "no expired proposals" );
+}
+
+void multisig::index( name proposer, name proposal_name, name payer ) {
+   require_auth( payer );
+
+   expirations exptable( _self, _self.value );
+   auto exp_idx = exptable.get_index<"byproposal"_n>();
+   eosio_assert( exp_idx.find( (uint128_t(proposer.value) << 64) | proposal_name.value ) == exp_idx.end(), "proposal is already indexed" );
+
+   // only proposals created by older versions of the contract are missing, they all keep their packed transaction
+   proposals proptable( _self, proposer.value );
+   auto& prop = proptable.get( proposal_name.value, "proposal not found" );
+   auto trx_header = unpack<transaction_header>( prop.packed_transaction );
+   add_expiration( payer, proposer, proposal_name, trx_header.expiration );
+}
+
+void multisig::release_blob( const eosio::checksum256& hash ) {
+   blobs blobtable( _self, _self.value );
+   auto blob_idx = blobtable.get_index<"byhash"_n>();
+   auto blob_it = blob_idx.find( hash );
+   eosio_assert( blob_it != blob_idx.end(), "blob not found" );
+
+   if( blob_it->references > 1 ) {
+      blob_idx.modify( blob_it, same_payer, [&]( auto& b ) {
+         --b.references;
+      });
+   } else {
+      // last proposal is gone, give the RAM back to the uploader
+      blob_datas datatable( _self, _self.value );
+      auto data_it = datatable.find( blob_it->id );
+      if( data_it != datatable.end() ) {
+         datatable.erase( data_it );
+      }
+      blob_idx.erase( blob_it );
+   }
+}
+
+void multisig::erase_chunks( name uploader, uint64_t upload_id ) {
+   blob_chunks chunktable( _self, uploader.value );
+   for( auto chunk_it = chunktable.lower_bound( upload_id << 32 ); chunk_it != chunktable.end() && chunk_it->upload_id == upload_id; ) {
+      chunk_it = chunktable.erase( chunk_it );
+   }
+}
+
+void multisig::add_expiration( name payer, name proposer, name proposal_name, time_point_sec expiration ) {
+   expirations exptable( _self, _self.value );
+   exptable.emplace( payer, [&]( auto& e ) {
+      e.id            = exptable.available_primary_key();
+      e.proposer      = proposer;
+      e.proposal_name = proposal_name;
+      e.expiration    = expiration;
+   });
+}
+
+void multisig::remove_expiration( name proposer, name proposal_name ) {
+   expirations exptable( _self, _self.value );
+   auto exp_idx = exptable.get_index<"byproposal"_n>();
+   auto exp_it = exp_idx.find( (uint128_t(proposer.value) << 64) | proposal_name.value );
+   // proposals created by older versions of the contract are not indexed
+   if( exp_it != exp_idx.end() ) {
+      exp_idx.erase( exp_it );
+   }
+}
+
+void multisig::erase_proposal( proposals& proptable, const proposal& prop, name proposer ) {
+   const name proposal_name = prop.proposal_name;
+   if( prop.packed_transaction.empty() ) {
+      release_blob( *prop.trx_hash );
+   }
+   proptable.erase(prop);
+
+   //remove from new table
+   approvals apptable(  _self, proposer.value );
+   auto apps_it = apptable.find( proposal_name.value );
+   if ( apps_it != apptable.end() ) {
+      apptable.erase(apps_it);
+   } else {
+      old_approvals old_apptable(  _self, proposer.value );
+      auto apps_it = old_apptable.find( proposal_name.value );
+      eosio_assert( apps_it != old_apptable.end(), "proposal not found" );
+      old_apptable.erase(apps_it);
+   }
+}
+
 } /// namespace eosio
 
-EOSIO_DISPATCH( eosio::multisig, (propose)(approve)(unapprove)(cancel)(exec)(invalidate) )
+EOSIO_DISPATCH( eosio::multisig, (propose)(approve)(approvebatch)(unapprove)(cancel)(exec)(invalidate)
+                (beginblob)(appendblob)(finalizeblob)(cancelblob)(proposeblob)(cleanup)(index) )
@@ -99,6 +99,29 @@ namespace eosiosystem {
       EOSLIB_SERIALIZE( eosio_global_state3, (last_vpay_state_update)(total_vpay_share_change_rate) )
    };
 
+   /**
+    * Ram fees are kept by eosio.ram when a trade is made and moved to eosio.ramfee in bulk by settleramfee
+    */
+   struct [[eosio::table("ramfees"), eosio::contract("eosio.system")]] ram_fees {
+      int64_t           unsettled = 0; ///< fees held by eosio.ram which are not yet transferred to eosio.ramfee
+
+      EOSLIB_SERIALIZE( ram_fees, (unsettled) )
+   };
+
+   /**
+    * Ram quote and volume published by the ram trades so that clients do not need to reimplement the market math.
+    * Every trade refreshes both, so the quote always matches the rammarket row.
+    */
+   struct [[eosio::table("ramprice"), eosio::contract("eosio.system")]] ram_price {
+      asset             sell_price_per_kb;   ///< core tokens the market pays for 1024 bytes before the 0.5% sell fee, buyers pay more
+      asset             volume;              ///< core tokens traded since window_start
+      int64_t           volume_bytes = 0;    ///< bytes traded since window_start
+      block_timestamp   window_start;        ///< start of the current one day volume window
+      block_timestamp   last_trade;
+
+      EOSLIB_SERIALIZE( ram_price, (sell_price_per_kb)(volume)(volume_bytes)(window_start)(last_trade) )
+   };
+
    struct [[eosio::table, eosio::contract("eosio.system")]] producer_info {
       name                  owner;
       double                total_votes = 0;
@@ -172,6 +195,23 @@ namespace eosiosystem {
    typedef eosio::singleton< "global"_n, eosio_global_state >   global_state_singleton;
    typedef eosio::singleton< "global2"_n, eosio_global_state2 > global_state2_singleton;
    typedef eosio::singleton< "global3"_n, eosio_global_state3 > global_state3_singleton;
+   typedef eosio::singleton< "ramfees"_n, ram_fees >            ram_fees_singleton;
+   typedef eosio::singleton< "ramprice"_n, ram_price >          ram_price_singleton;
+
+   /**
+    * Account to be created by the onboard action together with its ram and stake
+    */
+   struct onboard_account {
+      name        account;
+      authority   owner;
+      authority   active;
+      uint32_t    ram_bytes = 0;
+      asset       stake_net;
+      asset       stake_cpu;
+
+      // explicit serialization macro is not necessary, used here only to improve compilation time
+      EOSLIB_SERIALIZE( onboard_account, (account)(owner)(active)(ram_bytes)(stake_net)(stake_cpu) )
+   };
 
    //   static constexpr uint32_t     max_inflation_rate = 5;  // 5% annual inflation
    static constexpr uint32_t     seconds_per_day = 24 * 3600;
@@ -269,6 +309,13 @@ namespace eosiosystem {
          [[eosio::action]]
          void sellram( name account, int64_t bytes );
 
+         /**
+          *  Transfers the ram fees collected since the last call from eosio.ram to eosio.ramfee.
+          *  Can be called by any account.
+          */
+         [[eosio::action]]
+         void settleramfee();
+
          /**
           *  This action is called after the delegation-period to claim all pending
           *  unstaked tokens belonging to owner
@@ -276,6 +323,15 @@ namespace eosiosystem {
          [[eosio::action]]
          void refund( name owner );
 
+         /**
+          *  Creates accounts with the given ram and stake, paid by 'creator'. This is equivalent
+          *  to newaccount, buyrambytes and delegatebw (without transfer) for every account, but the
+          *  ram for the whole batch is bought in a single market trade and the tokens are moved
+          *  with a single transfer per destination.
+          */
+         [[eosio::action]]
+         void onboard( name creator, const std::vector<onboard_account>& accounts );
+
          // functions defined in voting.cpp
 
          [[eosio::action]]
@@ -333,11 +389,16 @@ namespace eosiosystem {
 
          symbol core_symbol()const;
 
+         int64_t new_ram_supply();
          void update_ram_supply();
 
          //defined in delegate_bandwidth.cpp
          void changebw( name from, name receiver,
                         asset stake_net_quantity, asset stake_cpu_quantity, bool transfer );
+         void buy_exact_ram( name payer, int64_t bytes );
+         void add_ram( name receiver, int64_t bytes );
+         void accrue_ram_fee( int64_t fee );
+         void publish_ram_price( const exchange_state& market, int64_t bytes, const asset& tokens );
 
          //defined in voting.hpp
          void update_elected_producers( block_timestamp timestamp );
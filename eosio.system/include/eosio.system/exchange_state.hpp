@@ -1,6 +1,7 @@
 #pragma once
 
 #include <eosiolib/asset.hpp>
+#include <eosiolib/multi_index.hpp>
 
 namespace eosiosystem {
    using eosio::asset;
@@ -32,6 +33,8 @@ namespace eosiosystem {
       asset convert_from_exchange( connector& c, asset in );
       asset convert( asset from, const symbol& to );
 
+      static int64_t get_bancor_input( int64_t out_reserve, int64_t inp_reserve, int64_t out );
+
       EOSLIB_SERIALIZE( exchange_state, (supply)(base)(quote) )
    };
 
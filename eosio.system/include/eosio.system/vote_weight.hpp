@@ -0,0 +1,24 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#pragma once
+
+#include <eosiolib/time.hpp>
+
+#include <cmath>
+#include <cstdint>
+
+namespace eosiosystem {
+
+   /**
+    *  Returns the vote weight of 'staked' tokens at 'now_sec' seconds since the unix epoch.
+    *  The weight doubles every 52 weeks so that newer votes outweigh older ones.
+    */
+   inline double stake2vote( int64_t staked, uint32_t now_sec ) {
+      /// TODO subtract 2080 brings the large numbers closer to this decade
+      double weight = int64_t( (now_sec - (eosio::block_timestamp::block_timestamp_epoch / 1000)) / (24 * 3600 * 7) )  / double( 52 );
+      return double(staked) * std::pow( 2, weight );
+   }
+
+} /// eosiosystem
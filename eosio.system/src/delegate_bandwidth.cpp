@@ -86,12 +86,62 @@ namespace eosiosystem {
     *  This action will buy an exact amount of ram and bill the payer the current market price.
     */
    void system_contract::buyrambytes( name payer, name receiver, uint32_t bytes ) {
+      require_auth( payer );
+
+      eosio_assert( bytes > 0, "must purchase a positive amount" );
+
+      buy_exact_ram( payer, bytes );
+      add_ram( receiver, bytes );
+   }
 
-      auto itr = _rammarket.find(ramcore_symbol.raw());
-      auto tmp = *itr;
-      auto eosout = tmp.convert( asset(bytes, ram_symbol), core_symbol() );
+   /**
+    *  Takes exactly 'bytes' from the ram market in a single update and transfers the cost
+    *  plus the 0.5% fee from 'payer'. The fee is charged on the total paid, as in buyram.
+    *  Ram produced since the last trade is added to the market in the same update.
+    */
+   void system_contract::buy_exact_ram( name payer, int64_t bytes ) {
+      const int64_t new_ram = new_ram_supply();
+      const auto& market = _rammarket.get(ramcore_symbol.raw(), "ram market does not exist");
+      const int64_t cost = exchange_state::get_bancor_input( market.base.balance.amount + new_ram, market.quote.balance.amount, bytes );
+      const int64_t fee  = ( cost + 198 ) / 199; /// .5% of the total paid (round up)
+      eosio_assert( cost > 0, "must purchase a positive amount" );
+      const symbol core_sym = market.quote.balance.symbol;
 
-      buyram( payer, receiver, eosout );
+      _rammarket.modify( market, same_payer, [&]( auto& es ) {
+         es.base.balance.amount  += new_ram - bytes;
+         es.quote.balance.amount += cost;
+      });
+      publish_ram_price( market, bytes, asset(cost, core_sym) );
+
+      _gstate.total_ram_bytes_reserved += uint64_t(bytes);
+      _gstate.total_ram_stake          += cost;
+
+      INLINE_ACTION_SENDER(eosio::token, transfer)(
+         token_account, { {payer, active_permission}, {ram_account, active_permission} },
+         { payer, ram_account, asset(cost + fee, core_sym), std::string("buy ram") }
+      );
+      accrue_ram_fee( fee );
+   }
+
+   /**
+    *  Adds purchased ram to the quota of 'receiver', who pays for the storage of the row.
+    */
+   void system_contract::add_ram( name receiver, int64_t bytes ) {
+      user_resources_table  userres( _self, receiver.value );
+      auto res_itr = userres.find( receiver.value );
+      if( res_itr ==  userres.end() ) {
+         res_itr = userres.emplace( receiver, [&]( auto& res ) {
+               res.owner = receiver;
+               res.net_weight = asset( 0, core_symbol() );
+               res.cpu_weight = asset( 0, core_symbol() );
+               res.ram_bytes = bytes;
+            });
+      } else {
+         userres.modify( res_itr, receiver, [&]( auto& res ) {
+               res.ram_bytes += bytes;
+            });
+      }
+      set_resource_limits( res_itr->owner.value, res_itr->ram_bytes + ram_gift_bytes, res_itr->net_weight.amount, res_itr->cpu_weight.amount );
    }
 
 
@@ -106,9 +156,9 @@ namespace eosiosystem {
    void system_contract::buyram( name payer, name receiver, asset quant )
    {
       require_auth( payer );
-      update_ram_supply();
 
-      eosio_assert( quant.symbol == core_symbol(), "must buy ram with core token" );
+      const auto& market = _rammarket.get(ramcore_symbol.raw(), "ram market does not exist");
+      eosio_assert( quant.symbol == market.quote.balance.symbol, "must buy ram with core token" );
       eosio_assert( quant.amount > 0, "must purchase a positive amount" );
 
       auto fee = quant;
@@ -119,47 +169,30 @@ namespace eosiosystem {
       auto quant_after_fee = quant;
       quant_after_fee.amount -= fee.amount;
       // quant_after_fee.amount should be > 0 if quant.amount > 1.
-      // If quant.amount == 1, then quant_after_fee.amount == 0 and the next inline transfer will fail causing the buyram action to fail.
+      // If quant.amount == 1, then quant_after_fee.amount == 0 and no bytes are bought, which fails the bytes_out assertion below.
 
+      // the fee is transferred to eosio.ram together with the payment and settled later
       INLINE_ACTION_SENDER(eosio::token, transfer)(
          token_account, { {payer, active_permission}, {ram_account, active_permission} },
-         { payer, ram_account, quant_after_fee, std::string("buy ram") }
+         { payer, ram_account, quant, std::string("buy ram") }
       );
-
-      if( fee.amount > 0 ) {
-         INLINE_ACTION_SENDER(eosio::token, transfer)(
-            token_account, { {payer, active_permission} },
-            { payer, ramfee_account, fee, std::string("ram fee") }
-         );
-      }
+      accrue_ram_fee( fee.amount );
 
       int64_t bytes_out;
 
-      const auto& market = _rammarket.get(ramcore_symbol.raw(), "ram market does not exist");
+      const int64_t new_ram = new_ram_supply();
       _rammarket.modify( market, same_payer, [&]( auto& es ) {
+          es.base.balance.amount += new_ram;
           bytes_out = es.convert( quant_after_fee,  ram_symbol ).amount;
       });
 
       eosio_assert( bytes_out > 0, "must reserve a positive amount" );
+      publish_ram_price( market, bytes_out, quant_after_fee );
 
       _gstate.total_ram_bytes_reserved += uint64_t(bytes_out);
       _gstate.total_ram_stake          += quant_after_fee.amount;
 
-      user_resources_table  userres( _self, receiver.value );
-      auto res_itr = userres.find( receiver.value );
-      if( res_itr ==  userres.end() ) {
-         res_itr = userres.emplace( receiver, [&]( auto& res ) {
-               res.owner = receiver;
-               res.net_weight = asset( 0, core_symbol() );
-               res.cpu_weight = asset( 0, core_symbol() );
-               res.ram_bytes = bytes_out;
-            });
-      } else {
-         userres.modify( res_itr, receiver, [&]( auto& res ) {
-               res.ram_bytes += bytes_out;
-            });
-      }
-      set_resource_limits( res_itr->owner.value, res_itr->ram_bytes + ram_gift_bytes, res_itr->net_weight.amount, res_itr->cpu_weight.amount );
+      add_ram( receiver, bytes_out );
    }
 
   /**
@@ -170,7 +203,6 @@ namespace eosiosystem {
     */
    void system_contract::sellram( name account, int64_t bytes ) {
       require_auth( account );
-      update_ram_supply();
 
       eosio_assert( bytes > 0, "cannot sell negative byte" );
 
@@ -180,13 +212,16 @@ namespace eosiosystem {
       eosio_assert( res_itr->ram_bytes >= bytes, "insufficient quota" );
 
       asset tokens_out;
-      auto itr = _rammarket.find(ramcore_symbol.raw());
-      _rammarket.modify( itr, same_payer, [&]( auto& es ) {
+      const int64_t new_ram = new_ram_supply();
+      const auto& market = _rammarket.get(ramcore_symbol.raw(), "ram market does not exist");
+      _rammarket.modify( market, same_payer, [&]( auto& es ) {
+          es.base.balance.amount += new_ram;
           /// the cast to int64_t of bytes is safe because we certify bytes is <= quota which is limited by prior purchases
-          tokens_out = es.convert( asset(bytes, ram_symbol), core_symbol());
+          tokens_out = es.convert( asset(bytes, ram_symbol), es.quote.balance.symbol );
       });
 
       eosio_assert( tokens_out.amount > 1, "token amount received from selling ram is too low" );
+      publish_ram_price( market, bytes, tokens_out );
 
       _gstate.total_ram_bytes_reserved -= static_cast<decltype(_gstate.total_ram_bytes_reserved)>(bytes); // bytes > 0 is asserted above
       _gstate.total_ram_stake          -= tokens_out.amount;
@@ -199,19 +234,59 @@ namespace eosiosystem {
       });
       set_resource_limits( res_itr->owner.value, res_itr->ram_bytes + ram_gift_bytes, res_itr->net_weight.amount, res_itr->cpu_weight.amount );
 
+      auto fee = ( tokens_out.amount + 199 ) / 200; /// .5% fee (round up)
+      // since tokens_out.amount was asserted to be at least 2 earlier, fee.amount < tokens_out.amount
+      // the fee stays with eosio.ram and is settled later
       INLINE_ACTION_SENDER(eosio::token, transfer)(
          token_account, { {ram_account, active_permission}, {account, active_permission} },
-         { ram_account, account, asset(tokens_out), std::string("sell ram") }
+         { ram_account, account, asset(tokens_out.amount - fee, tokens_out.symbol), std::string("sell ram") }
       );
+      accrue_ram_fee( fee );
+   }
 
-      auto fee = ( tokens_out.amount + 199 ) / 200; /// .5% fee (round up)
-      // since tokens_out.amount was asserted to be at least 2 earlier, fee.amount < tokens_out.amount
-      if( fee > 0 ) {
-         INLINE_ACTION_SENDER(eosio::token, transfer)(
-            token_account, { {account, active_permission} },
-            { account, ramfee_account, asset(fee, core_symbol()), std::string("sell ram fee") }
-         );
+   void system_contract::accrue_ram_fee( int64_t fee ) {
+      if( fee == 0 ) return;
+
+      ram_fees_singleton fees( _self, _self.value );
+      auto f = fees.get_or_default();
+      f.unsettled += fee;
+      fees.set( f, _self );
+   }
+
+   void system_contract::publish_ram_price( const exchange_state& market, int64_t bytes, const asset& tokens ) {
+      static constexpr uint32_t blocks_per_day = seconds_per_day * 1000 / block_timestamp::block_interval_ms;
+
+      ram_price_singleton prices( _self, _self.value );
+      auto p = prices.get_or_default();
+      const auto cbt = current_block_time();
+
+      if( p.volume.symbol != tokens.symbol || cbt.slot - p.window_start.slot >= blocks_per_day ) {
+         p.volume       = asset( 0, tokens.symbol );
+         p.volume_bytes = 0;
+         p.window_start = cbt;
       }
+      p.volume       += tokens;
+      p.volume_bytes += bytes;
+
+      auto quote = market;
+      p.sell_price_per_kb = quote.convert( asset(1024, ram_symbol), tokens.symbol );
+      p.last_trade        = cbt;
+
+      prices.set( p, _self );
+   }
+
+   void system_contract::settleramfee() {
+      ram_fees_singleton fees( _self, _self.value );
+      auto f = fees.get_or_default();
+      eosio_assert( f.unsettled > 0, "no ram fees to settle" );
+
+      INLINE_ACTION_SENDER(eosio::token, transfer)(
+         token_account, { {ram_account, active_permission} },
+         { ram_account, ramfee_account, asset(f.unsettled, core_symbol()), std::string("ram fee") }
+      );
+
+      f.unsettled = 0;
+      fees.set( f, _self );
    }
 
    void validate_b1_vesting( int64_t stake ) {
@@ -449,5 +524,80 @@ namespace eosiosystem {
       refunds_tbl.erase( req );
    }
 
+   void system_contract::onboard( name creator, const std::vector<onboard_account>& accounts ) {
+      require_auth( creator );
+      eosio_assert( accounts.size() > 0, "no accounts to create" );
+
+      const asset zero_asset( 0, core_symbol() );
+      int64_t total_bytes = 0;
+      asset   total_stake = zero_asset;
+      for( const auto& acc : accounts ) {
+         eosio_assert( !is_account( acc.account ), "account already exists" );
+         eosio_assert( acc.stake_net >= zero_asset, "must not stake a negative amount" );
+         eosio_assert( acc.stake_cpu >= zero_asset, "must not stake a negative amount" );
+         total_bytes += acc.ram_bytes;
+         total_stake += acc.stake_net + acc.stake_cpu;
+      }
+
+      // buy the ram of the whole batch with a single trade
+      if( total_bytes > 0 ) {
+         buy_exact_ram( creator, total_bytes );
+      }
+
+      if( total_stake.amount > 0 ) {
+         INLINE_ACTION_SENDER(eosio::token, transfer)(
+            token_account, { {creator, active_permission} },
+            { creator, stake_account, total_stake, std::string("stake bandwidth") }
+         );
+      }
+
+      // resource rows are created here, newaccount only applies the limits from them. Like newaccount, accounts
+      // without ram or stake get no row and zero limits
+      del_bandwidth_table del_tbl( _self, creator.value );
+      for( const auto& acc : accounts ) {
+         if( acc.ram_bytes > 0 || acc.stake_net.amount > 0 || acc.stake_cpu.amount > 0 ) {
+            user_resources_table userres( _self, acc.account.value );
+            userres.emplace( creator, [&]( auto& res ) {
+               res.owner      = acc.account;
+               res.net_weight = acc.stake_net;
+               res.cpu_weight = acc.stake_cpu;
+               res.ram_bytes  = acc.ram_bytes;
+            });
+         }
+
+         if( acc.stake_net.amount > 0 || acc.stake_cpu.amount > 0 ) {
+            del_tbl.emplace( creator, [&]( auto& dbo ) {
+               dbo.from       = creator;
+               dbo.to         = acc.account;
+               dbo.net_weight = acc.stake_net;
+               dbo.cpu_weight = acc.stake_cpu;
+            });
+         }
+
+         eosio::action( permission_level{ creator, active_permission }, _self, "newaccount"_n,
+                        std::make_tuple( creator, acc.account, acc.owner, acc.active )
+         ).send();
+      }
+
+      // update voting power of the creator once for the whole batch
+      if( total_stake.amount > 0 ) {
+         auto from_voter = _voters.find( creator.value );
+         if( from_voter == _voters.end() ) {
+            from_voter = _voters.emplace( creator, [&]( auto& v ) {
+                  v.owner  = creator;
+                  v.staked = total_stake.amount;
+               });
+         } else {
+            _voters.modify( from_voter, same_payer, [&]( auto& v ) {
+                  v.staked += total_stake.amount;
+               });
+         }
+
+         if( from_voter->producers.size() || from_voter->proxy ) {
+            update_votes( creator, from_voter->proxy, from_voter->producers, false );
+         }
+      }
+   }
+
 
 } //namespace eosiosystem
@@ -74,14 +74,27 @@ namespace eosiosystem {
       _gstate.max_ram_size = max_ram_size;
    }
 
-   void system_contract::update_ram_supply() {
+   /**
+    *  Accounts for the ram produced since the last increase and returns the number of bytes
+    *  the caller must add to the base balance of the ram market.
+    */
+   int64_t system_contract::new_ram_supply() {
       auto cbt = current_block_time();
 
-      if( cbt <= _gstate2.last_ram_increase ) return;
+      if( cbt <= _gstate2.last_ram_increase ) return 0;
 
-      auto itr = _rammarket.find(ramcore_symbol.raw());
       auto new_ram = (cbt.slot - _gstate2.last_ram_increase.slot)*_gstate2.new_ram_per_block;
       _gstate.max_ram_size += new_ram;
+      _gstate2.last_ram_increase = cbt;
+
+      return new_ram;
+   }
+
+   void system_contract::update_ram_supply() {
+      const int64_t new_ram = new_ram_supply();
+      if( new_ram == 0 ) return;
+
+      auto itr = _rammarket.find(ramcore_symbol.raw());
 
       /**
        *  Increase the amount of ram for sale based upon the change in max ram size.
@@ -89,7 +102,6 @@ namespace eosiosystem {
       _rammarket.modify( itr, same_payer, [&]( auto& m ) {
          m.base.balance.amount += new_ram;
       });
-      _gstate2.last_ram_increase = cbt;
    }
 
    /**
@@ -123,6 +135,10 @@ namespace eosiosystem {
       user_resources_table userres( _self, account.value );
       auto ritr = userres.find( account.value );
       eosio_assert( ritr == userres.end(), "only supports unlimited accounts" );
+      // newaccount no longer creates the row, idle accounts are told apart by the zero limits it gives them
+      int64_t current_ram, current_net, current_cpu;
+      get_resource_limits( account.value, &current_ram, &current_net, &current_cpu );
+      eosio_assert( current_ram != 0 || current_net != 0 || current_cpu != 0, "only supports unlimited accounts" );
       set_resource_limits( account.value, ram, net, cpu );
    }
 
@@ -255,15 +271,16 @@ namespace eosiosystem {
          }
       }
 
+      // the resources row is created by the first buyram or delegatebw, a missing row means no resources
       user_resources_table  userres( _self, newact.value);
+      auto res_itr = userres.find( newact.value );
 
-      userres.emplace( newact, [&]( auto& res ) {
-        res.owner = newact;
-        res.net_weight = asset( 0, system_contract::get_core_symbol() );
-        res.cpu_weight = asset( 0, system_contract::get_core_symbol() );
-      });
-
-      set_resource_limits( newact.value, 0, 0, 0 );
+      if( res_itr == userres.end() ) {
+         set_resource_limits( newact.value, 0, 0, 0 );
+      } else {
+         // resources were already provided by the onboard action which created this account
+         set_resource_limits( newact.value, res_itr->ram_bytes + ram_gift_bytes, res_itr->net_weight.amount, res_itr->cpu_weight.amount );
+      }
    }
 
    void native::setabi( name acnt, const std::vector<char>& abi ) {
@@ -310,7 +327,7 @@ EOSIO_DISPATCH( eosiosystem::system_contract,
      // eosio.system.cpp
      (init)(setram)(setramrate)(setparams)(setpriv)(setalimits)(rmvproducer)(updtrevision)(bidname)(bidrefund)
      // delegate_bandwidth.cpp
-     (buyrambytes)(buyram)(sellram)(delegatebw)(undelegatebw)(refund)
+     (buyrambytes)(buyram)(sellram)(settleramfee)(delegatebw)(undelegatebw)(refund)(onboard)
      // voting.cpp
      (regproducer)(unregprod)(voteproducer)(regproxy)
      // producer_pay.cpp
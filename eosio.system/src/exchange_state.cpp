@@ -1,5 +1,7 @@
 #include <eosio.system/exchange_state.hpp>
 
+#include <cmath>
+
 namespace eosiosystem {
    asset exchange_state::convert_to_exchange( connector& c, asset in ) {
 
@@ -79,5 +81,18 @@ namespace eosiosystem {
    }
 
 
+   /**
+    *  Returns the amount of the input asset that has to be added to the relay to take exactly
+    *  'out' units of the output asset, rounded up in favor of the relay. With the 50/50 weights
+    *  used by the ram market, convert() behaves as a constant product market, so this is its inverse.
+    */
+   int64_t exchange_state::get_bancor_input( int64_t out_reserve, int64_t inp_reserve, int64_t out ) {
+      eosio_assert( 0 < out && out < out_reserve, "requested amount exceeds available reserve" );
+
+      const real_type ob(out_reserve);
+      const real_type ib(inp_reserve);
+
+      return int64_t( std::ceil( (ib * out) / (ob - out) ) );
+   }
 
 } /// namespace eosiosystem
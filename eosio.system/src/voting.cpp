@@ -3,6 +3,7 @@
  *  @copyright defined in eos/LICENSE.txt
  */
 #include <eosio.system/eosio.system.hpp>
+#include <eosio.system/vote_weight.hpp>
 
 #include <eosiolib/eosio.hpp>
 #include <eosiolib/crypto.h>
@@ -120,9 +121,7 @@ namespace eosiosystem {
    }
 
    double stake2vote( int64_t staked ) {
-      /// TODO subtract 2080 brings the large numbers closer to this decade
-      double weight = int64_t( (now() - (block_timestamp::block_timestamp_epoch / 1000)) / (seconds_per_day * 7) )  / double( 52 );
-      return double(staked) * std::pow( 2, weight );
+      return stake2vote( staked, now() );
    }
 
    double system_contract::update_total_votepay_share( time_point ct,
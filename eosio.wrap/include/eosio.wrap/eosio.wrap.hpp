@@ -13,6 +13,16 @@ namespace eosio {
          [[eosio::action]]
          void exec( ignore<name> executer, ignore<transaction> trx );
 
+         [[eosio::action]]
+         void execinline( name executer, const transaction& trx );
+
+         [[eosio::action]]
+         void execbatch( name executer, const std::vector<transaction>& trxs );
+
+      private:
+         /// inline execution needs a transaction without delay and without context-free actions
+         void check_inline( const transaction& trx );
+         void send_actions( const transaction& trx );
    };
 
 } /// namespace eosio
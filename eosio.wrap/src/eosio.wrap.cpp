@@ -13,6 +13,38 @@ void wrap::exec( ignore<name>, ignore<transaction> ) {
    send_deferred( (uint128_t(executer.value) << 64) | current_time(), executer.value, _ds.pos(), _ds.remaining() );
 }
 
+void wrap::execinline( name executer, const transaction& trx ) {
+   require_auth( _self );
+   require_auth( executer );
+
+   check_inline( trx );
+   send_actions( trx );
+}
+
+void wrap::execbatch( name executer, const std::vector<transaction>& trxs ) {
+   require_auth( _self );
+   require_auth( executer );
+   eosio_assert( trxs.size() > 0, "no transactions to execute" );
+
+   for( const auto& trx : trxs ) {
+      check_inline( trx );
+   }
+   for( const auto& trx : trxs ) {
+      send_actions( trx );
+   }
+}
+
+void wrap::check_inline( const transaction& trx ) {
+   eosio_assert( trx.delay_sec.value == 0, "inline execution requires a transaction without delay" );
+   eosio_assert( trx.context_free_actions.empty(), "inline execution doesn't support context-free actions" );
+}
+
+void wrap::send_actions( const transaction& trx ) {
+   for( const auto& act : trx.actions ) {
+      act.send();
+   }
+}
+
 } /// namespace eosio
 
-EOSIO_DISPATCH( eosio::wrap, (exec) )
+EOSIO_DISPATCH( eosio::wrap, (exec)(execinline)(execbatch) )
@@ -0,0 +1,176 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Measures the throughput of the ram market and vote weight math and the precision drift of
+ *  randomized buy/sell sequences. Exits with a non zero code if a sequence takes more tokens or
+ *  bytes out of the market than were put in.
+ */
+#include <eosio.system/exchange_state.hpp>
+#include <eosio.system/vote_weight.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+
+using namespace eosiosystem;
+
+namespace {
+
+   const symbol ramcore_symbol( "RAMCORE", 4 );
+   const symbol ram_symbol( "RAM", 0 );
+   const symbol core_symbol( "SYS", 4 );
+
+   /// same parameters as system_contract::init with 64 GiB of ram and a supply of 10B tokens
+   exchange_state initial_market() {
+      exchange_state m;
+      m.supply        = asset( 100000000000000ll, ramcore_symbol );
+      m.base.balance  = asset( 64ll * 1024 * 1024 * 1024, ram_symbol );
+      m.quote.balance = asset( 100000000000000ll / 1000, core_symbol );
+      return m;
+   }
+
+   struct options {
+      uint64_t iterations = 1000000;
+      uint64_t seed       = 1;
+   };
+
+   bool parse_options( int argc, char** argv, options& opts ) {
+      for( int i = 1; i < argc; ++i ) {
+         if( !std::strcmp( argv[i], "--iterations" ) && i + 1 < argc ) {
+            opts.iterations = std::strtoull( argv[++i], nullptr, 10 );
+         } else if( !std::strcmp( argv[i], "--seed" ) && i + 1 < argc ) {
+            opts.seed = std::strtoull( argv[++i], nullptr, 10 );
+         } else {
+            std::cerr << "usage: " << argv[0] << " [--iterations N] [--seed S]" << std::endl;
+            return false;
+         }
+      }
+      return opts.iterations > 0;
+   }
+
+   template<typename F>
+   double ops_per_second( uint64_t ops, F&& f ) {
+      const auto start = std::chrono::steady_clock::now();
+      f();
+      const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+      return elapsed.count() > 0 ? ops / elapsed.count() : 0;
+   }
+
+   /**
+    *  Random buys of up to 10000 tokens and sells of part of the bytes held, then sells all
+    *  remaining bytes. The market must end with its initial ram and at least its initial tokens.
+    */
+   bool bench_buy_sell( const options& opts ) {
+      std::mt19937_64 rng( opts.seed );
+      exchange_state market = initial_market();
+      const exchange_state initial = market;
+
+      int64_t tokens_in  = 0;
+      int64_t tokens_out = 0;
+      int64_t held       = 0;
+      uint64_t conversions = 0;
+
+      const double rate = ops_per_second( opts.iterations, [&]() {
+         for( uint64_t i = 0; i < opts.iterations; ++i ) {
+            if( held == 0 || rng() % 2 ) {
+               const int64_t quant = 1 + int64_t( rng() % 100000000ull );
+               held      += market.convert( asset( quant, core_symbol ), ram_symbol ).amount;
+               tokens_in += quant;
+            } else {
+               const int64_t bytes = 1 + int64_t( rng() % uint64_t(held) );
+               tokens_out += market.convert( asset( bytes, ram_symbol ), core_symbol ).amount;
+               held       -= bytes;
+            }
+         }
+         conversions = opts.iterations;
+      });
+
+      if( held > 0 ) {
+         tokens_out += market.convert( asset( held, ram_symbol ), core_symbol ).amount;
+         held = 0;
+      }
+
+      const int64_t kept = tokens_in - tokens_out;
+      std::cout << "buy/sell conversions:      " << conversions << " in " << rate << " conversions/s" << std::endl;
+      std::cout << "  tokens traded:           " << tokens_in + tokens_out << std::endl;
+      std::cout << "  tokens kept by market:   " << kept << " ("
+                << ( tokens_in > 0 ? double(kept) / tokens_in : 0 ) << " of tokens in)" << std::endl;
+      std::cout << "  supply drift:            " << market.supply.amount - initial.supply.amount << std::endl;
+
+      bool ok = true;
+      if( kept < 0 ) {
+         std::cerr << "error: market paid out " << -kept << " more tokens than it received" << std::endl;
+         ok = false;
+      }
+      if( market.base.balance != initial.base.balance ) {
+         std::cerr << "error: ram balance drifted by " << market.base.balance.amount - initial.base.balance.amount << std::endl;
+         ok = false;
+      }
+      if( market.quote.balance.amount - initial.quote.balance.amount != kept ) {
+         std::cerr << "error: token balance does not match the tokens kept by the market" << std::endl;
+         ok = false;
+      }
+      return ok;
+   }
+
+   /**
+    *  Compares get_bancor_input quotes used by buyrambytes against the bytes that convert gives
+    *  for the same amount of tokens.
+    */
+   bool bench_bancor_input( const options& opts ) {
+      std::mt19937_64 rng( opts.seed + 1 );
+      const exchange_state market = initial_market();
+
+      uint64_t short_quotes = 0;
+      int64_t  checksum     = 0;
+      const double rate = ops_per_second( opts.iterations, [&]() {
+         for( uint64_t i = 0; i < opts.iterations; ++i ) {
+            const int64_t bytes = 1 + int64_t( rng() % ( 1024ull * 1024 * 1024 ) );
+            checksum += exchange_state::get_bancor_input( market.base.balance.amount, market.quote.balance.amount, bytes );
+         }
+      });
+
+      for( uint64_t i = 0; i < opts.iterations; ++i ) {
+         const int64_t bytes = 1 + int64_t( rng() % ( 1024ull * 1024 * 1024 ) );
+         const int64_t cost  = exchange_state::get_bancor_input( market.base.balance.amount, market.quote.balance.amount, bytes );
+         exchange_state m = market;
+         if( m.convert( asset( cost, core_symbol ), ram_symbol ).amount < bytes )
+            ++short_quotes;
+      }
+
+      std::cout << "get_bancor_input:          " << rate << " quotes/s (checksum " << checksum << ")" << std::endl;
+      std::cout << "  quotes short in convert: " << short_quotes << " of " << opts.iterations << std::endl;
+      return true;
+   }
+
+   bool bench_stake2vote( const options& opts ) {
+      std::mt19937_64 rng( opts.seed + 2 );
+      const uint32_t now_sec = 1546300800; // 2019-01-01
+
+      double checksum = 0;
+      const double rate = ops_per_second( opts.iterations, [&]() {
+         for( uint64_t i = 0; i < opts.iterations; ++i ) {
+            checksum += stake2vote( int64_t( rng() % 10000000000000ull ), now_sec + uint32_t( i % ( 3600 * 24 * 365 ) ) );
+         }
+      });
+
+      std::cout << "stake2vote:                " << rate << " weights/s (checksum " << checksum << ")" << std::endl;
+      return true;
+   }
+
+} /// namespace
+
+int main( int argc, char** argv ) {
+   options opts;
+   if( !parse_options( argc, argv, opts ) )
+      return 2;
+
+   bool ok = true;
+   ok = bench_buy_sell( opts ) && ok;
+   ok = bench_bancor_input( opts ) && ok;
+   ok = bench_stake2vote( opts ) && ok;
+   return ok ? 0 : 1;
+}
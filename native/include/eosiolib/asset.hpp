@@ -0,0 +1,80 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Host replacement of eosiolib/asset.hpp with the subset of symbol and asset used by
+ *  exchange_state. Amounts are not range checked.
+ */
+#pragma once
+
+#include <eosiolib/system.h>
+
+#include <string_view>
+
+#define EOSLIB_SERIALIZE( TYPE, MEMBERS )
+
+namespace eosio {
+
+   class symbol_code {
+      public:
+         constexpr symbol_code() : value(0) {}
+         constexpr explicit symbol_code( uint64_t raw ) : value(raw) {}
+         constexpr explicit symbol_code( std::string_view str ) : value(0) {
+            for( auto itr = str.rbegin(); itr != str.rend(); ++itr ) {
+               value <<= 8;
+               value |= *itr;
+            }
+         }
+
+         constexpr uint64_t raw()const { return value; }
+
+         friend constexpr bool operator == ( const symbol_code& a, const symbol_code& b ) { return a.value == b.value; }
+         friend constexpr bool operator != ( const symbol_code& a, const symbol_code& b ) { return a.value != b.value; }
+
+      private:
+         uint64_t value;
+   };
+
+   class symbol {
+      public:
+         constexpr symbol() : value(0) {}
+         constexpr explicit symbol( uint64_t raw ) : value(raw) {}
+         constexpr symbol( symbol_code sc, uint8_t precision ) : value( (sc.raw() << 8) | precision ) {}
+         constexpr symbol( std::string_view ss, uint8_t precision ) : value( (symbol_code(ss).raw() << 8) | precision ) {}
+
+         constexpr uint64_t    raw()const       { return value; }
+         constexpr uint8_t     precision()const { return value & 0xFF; }
+         constexpr symbol_code code()const      { return symbol_code{value >> 8}; }
+
+         friend constexpr bool operator == ( const symbol& a, const symbol& b ) { return a.value == b.value; }
+         friend constexpr bool operator != ( const symbol& a, const symbol& b ) { return a.value != b.value; }
+
+      private:
+         uint64_t value;
+   };
+
+   struct asset {
+      int64_t        amount = 0;
+      eosio::symbol  symbol;
+
+      asset() {}
+      asset( int64_t a, eosio::symbol s ) : amount(a), symbol(s) {}
+
+      asset& operator += ( const asset& a ) {
+         eosio_assert( a.symbol == symbol, "attempt to add asset with different symbol" );
+         amount += a.amount;
+         return *this;
+      }
+      asset& operator -= ( const asset& a ) {
+         eosio_assert( a.symbol == symbol, "attempt to subtract asset with different symbol" );
+         amount -= a.amount;
+         return *this;
+      }
+
+      friend asset operator + ( const asset& a, const asset& b ) { asset r = a; r += b; return r; }
+      friend asset operator - ( const asset& a, const asset& b ) { asset r = a; r -= b; return r; }
+      friend bool operator == ( const asset& a, const asset& b ) { return a.symbol == b.symbol && a.amount == b.amount; }
+      friend bool operator != ( const asset& a, const asset& b ) { return !( a == b ); }
+   };
+
+} /// namespace eosio
@@ -0,0 +1,48 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Host replacement of eosiolib/multi_index.hpp. Tables only exist on chain, so multi_index
+ *  is declared to let the contract headers name their table types but cannot be instantiated.
+ */
+#pragma once
+
+#include <cstdint>
+
+namespace eosio {
+
+   struct name {
+      enum class raw : uint64_t {};
+
+      constexpr name() : value(0) {}
+      constexpr explicit name( uint64_t v ) : value(v) {}
+
+      constexpr operator raw()const { return raw(value); }
+
+      static constexpr uint8_t char_to_value( char c ) {
+         if( c == '.' )
+            return 0;
+         else if( c >= '1' && c <= '5' )
+            return (c - '1') + 1;
+         else if( c >= 'a' && c <= 'z' )
+            return (c - 'a') + 6;
+         return 0;
+      }
+
+      uint64_t value;
+   };
+
+   template<name::raw TableName, typename T, typename... Indices>
+   class multi_index;
+
+} /// namespace eosio
+
+template <typename T, T... Str>
+inline constexpr eosio::name operator""_n() {
+   constexpr const char str[] = { Str... };
+   uint64_t value = 0;
+   for( unsigned i = 0; i < sizeof...(Str) && i < 12; ++i ) {
+      value |= uint64_t( eosio::name::char_to_value( str[i] ) & 0x1f ) << ( 64 - 5 * (i + 1) );
+   }
+   return eosio::name{value};
+}
@@ -0,0 +1,15 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Host replacement of the eosiolib system api, used to build the pure parts of the
+ *  contracts natively. A failed assertion throws instead of aborting the transaction.
+ */
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+
+inline void eosio_assert( uint32_t test, const char* msg ) {
+   if( !test ) throw std::runtime_error( msg );
+}
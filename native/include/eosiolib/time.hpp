@@ -0,0 +1,22 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Host replacement of eosiolib/time.hpp with the block timestamp constants.
+ */
+#pragma once
+
+#include <cstdint>
+
+namespace eosio {
+
+   class block_timestamp {
+      public:
+         explicit block_timestamp( uint32_t s = 0 ) : slot(s) {}
+
+         uint32_t slot;
+         static constexpr int32_t block_interval_ms = 500;
+         static constexpr int64_t block_timestamp_epoch = 946684800000ll;  // epoch is year 2000
+   };
+
+} /// namespace eosio
@@ -0,0 +1,78 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Writes a copy of a contract which counts the wasm instructions executed by each of its functions and its
+ *  database calls, see wasm_profiler.hpp, and prints each counter in the order of the indices printed by apply.
+ */
+#include "wasm_profiler.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+namespace {
+
+   struct arguments {
+      std::string             input;
+      std::string             output;
+      wasm_profiler::options  opts;
+   };
+
+   bool parse_arguments( int argc, char** argv, arguments& args ) {
+      for( int i = 1; i < argc; ++i ) {
+         if( !std::strcmp( argv[i], "--function" ) && i + 1 < argc ) {
+            args.opts.functions.push_back( argv[++i] );
+         } else if( !std::strcmp( argv[i], "--import" ) && i + 1 < argc ) {
+            args.opts.imports.push_back( argv[++i] );
+         } else if( !std::strcmp( argv[i], "--max-counters" ) && i + 1 < argc ) {
+            args.opts.max_counters = std::strtoul( argv[++i], nullptr, 10 );
+         } else if( argv[i][0] != '-' && args.input.empty() ) {
+            args.input = argv[i];
+         } else if( argv[i][0] != '-' && args.output.empty() ) {
+            args.output = argv[i];
+         } else {
+            args.output.clear();
+            break;
+         }
+      }
+      if( args.output.empty() ) {
+         std::cerr << "usage: " << argv[0] << " <contract.wasm> <profiled.wasm> [--function SUBSTRING]... [--import PREFIX]... [--max-counters N]" << std::endl;
+         return false;
+      }
+      return true;
+   }
+
+} /// namespace
+
+int main( int argc, char** argv ) {
+   arguments args;
+   if( !parse_arguments( argc, argv, args ) ) return 1;
+
+   std::ifstream in( args.input, std::ios::binary );
+   if( !in ) {
+      std::cerr << "cannot read " << args.input << std::endl;
+      return 1;
+   }
+   const std::vector<uint8_t> wasm( ( std::istreambuf_iterator<char>( in ) ), std::istreambuf_iterator<char>() );
+
+   try {
+      const auto profiled = wasm_profiler::instrument( wasm, args.opts );
+      std::ofstream out( args.output, std::ios::binary );
+      out.write( reinterpret_cast<const char*>( profiled.wasm.data() ), profiled.wasm.size() );
+      if( !out ) {
+         std::cerr << "cannot write " << args.output << std::endl;
+         return 1;
+      }
+      static const char* const kinds[] = { "instructions", "calls", "bytes" };
+      for( size_t i = 0; i < profiled.counters.size(); ++i ) {
+         std::cout << i << " " << kinds[int( profiled.counters[i].kind )] << " " << profiled.counters[i].name << std::endl;
+      }
+   } catch( const std::exception& e ) {
+      std::cerr << args.input << ": " << e.what() << std::endl;
+      return 1;
+   }
+   return 0;
+}
@@ -0,0 +1,764 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#include "wasm_profiler.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <stdexcept>
+
+namespace wasm_profiler {
+
+const char* const console_marker = "wasmprofile";
+
+namespace {
+
+   enum section_id : uint8_t {
+      custom_section   = 0,
+      type_section     = 1,
+      import_section   = 2,
+      function_section = 3,
+      global_section   = 6,
+      export_section   = 7,
+      start_section    = 8,
+      element_section  = 9,
+      code_section     = 10
+   };
+
+   enum external_kind : uint8_t { external_function = 0, external_table = 1, external_memory = 2, external_global = 3 };
+
+   enum value_type : uint8_t { i32 = 0x7f, i64 = 0x7e, f32 = 0x7d, f64 = 0x7c };
+
+   // the opcodes the instrumentation emits or has to look at
+   enum opcode : uint8_t {
+      op_unreachable = 0x00, op_block = 0x02, op_loop = 0x03, op_if = 0x04, op_else = 0x05, op_end = 0x0b,
+      op_br = 0x0c, op_br_if = 0x0d, op_br_table = 0x0e, op_return = 0x0f, op_call = 0x10, op_call_indirect = 0x11,
+      op_local_get = 0x20, op_local_set = 0x21, op_local_tee = 0x22, op_global_get = 0x23, op_global_set = 0x24,
+      op_i32_load = 0x28, op_i64_store32 = 0x3e, op_memory_size = 0x3f, op_memory_grow = 0x40,
+      op_i32_const = 0x41, op_i64_const = 0x42, op_f32_const = 0x43, op_f64_const = 0x44,
+      op_i32_add = 0x6a, op_i64_extend_i32_u = 0xad, op_last_numeric = 0xbf
+   };
+
+   const uint32_t max_mutable_global_bytes = 1024;
+
+   struct error : std::runtime_error {
+      using std::runtime_error::runtime_error;
+   };
+
+   struct reader {
+      const uint8_t* pos;
+      const uint8_t* end;
+
+      bool done()const { return pos == end; }
+
+      uint8_t byte() {
+         if( pos == end ) throw error( "unexpected end of wasm" );
+         return *pos++;
+      }
+
+      const uint8_t* take( uint32_t size ) {
+         if( size_t(end - pos) < size ) throw error( "unexpected end of wasm" );
+         const uint8_t* start = pos;
+         pos += size;
+         return start;
+      }
+
+      uint64_t uleb() {
+         uint64_t result = 0;
+         for( int shift = 0; shift < 64; shift += 7 ) {
+            const uint8_t b = byte();
+            result |= uint64_t( b & 0x7f ) << shift;
+            if( !( b & 0x80 ) ) return result;
+         }
+         throw error( "invalid leb128" );
+      }
+
+      uint32_t u32() { return uint32_t( uleb() ); }
+
+      // signed immediates are only copied, so they are skipped without decoding
+      void skip_leb() {
+         while( byte() & 0x80 ) {}
+      }
+
+      std::string str() {
+         const uint32_t size = u32();
+         const uint8_t* start = take( size );
+         return std::string( start, start + size );
+      }
+   };
+
+   void put_u32( std::vector<uint8_t>& out, uint32_t value ) {
+      do {
+         uint8_t b = value & 0x7f;
+         value >>= 7;
+         if( value ) b |= 0x80;
+         out.push_back( b );
+      } while( value );
+   }
+
+   void put_s64( std::vector<uint8_t>& out, int64_t value ) {
+      bool more = true;
+      while( more ) {
+         uint8_t b = value & 0x7f;
+         value >>= 7;
+         if( ( value == 0 && !( b & 0x40 ) ) || ( value == -1 && ( b & 0x40 ) ) ) {
+            more = false;
+         } else {
+            b |= 0x80;
+         }
+         out.push_back( b );
+      }
+   }
+
+   void put_str( std::vector<uint8_t>& out, const std::string& s ) {
+      put_u32( out, s.size() );
+      out.insert( out.end(), s.begin(), s.end() );
+   }
+
+   void put_bytes( std::vector<uint8_t>& out, const uint8_t* begin, const uint8_t* end ) {
+      out.insert( out.end(), begin, end );
+   }
+
+   /// value of an eosio name, as printed by the printn intrinsic
+   uint64_t name_value( const std::string& s ) {
+      uint64_t value = 0;
+      for( size_t i = 0; i < 12 && i < s.size(); ++i ) {
+         uint64_t c = 0;
+         if( s[i] >= 'a' && s[i] <= 'z' ) c = s[i] - 'a' + 6;
+         else if( s[i] >= '1' && s[i] <= '5' ) c = s[i] - '1' + 1;
+         value |= ( c & 0x1f ) << ( 64 - 5 * ( i + 1 ) );
+      }
+      return value;
+   }
+
+   struct section {
+      uint8_t              id;
+      std::string          name; ///< of custom sections
+      std::vector<uint8_t> payload;
+   };
+
+   struct function_type {
+      std::vector<uint8_t> params;
+      std::vector<uint8_t> results;
+
+      bool operator==( const function_type& other )const { return params == other.params && results == other.results; }
+   };
+
+   struct import_entry {
+      std::string          module;
+      std::string          field;
+      uint8_t              kind;
+      std::vector<uint8_t> desc; ///< encoded type of the import
+      uint32_t             type_index = 0; ///< of function imports
+   };
+
+   class instrumenter {
+   public:
+      instrumenter( const std::vector<uint8_t>& wasm, const options& opts ) : opts( opts ) {
+         static const uint8_t header[] = { 0x00, 0x61, 0x73, 0x6d, 0x01, 0x00, 0x00, 0x00 };
+         if( wasm.size() < sizeof(header) || !std::equal( header, header + sizeof(header), wasm.begin() ) )
+            throw error( "not a version 1 wasm module" );
+
+         reader r{ wasm.data() + sizeof(header), wasm.data() + wasm.size() };
+         while( !r.done() ) {
+            section s;
+            s.id = r.byte();
+            reader payload{ nullptr, nullptr };
+            const uint32_t size = r.u32();
+            payload.pos = r.take( size );
+            payload.end = payload.pos + size;
+            if( s.id == custom_section ) {
+               s.name = payload.str();
+            }
+            s.payload.assign( payload.pos, payload.end );
+            sections.push_back( std::move(s) );
+         }
+      }
+
+      instrumented_module run() {
+         read_types();
+         read_imports();
+         read_functions();
+         read_names();
+         assign_counters();
+
+         add_import( "printn" );
+         add_import( "printui" );
+         const uint32_t original_functions = imported_functions;
+         const uint32_t added_imports = imports.size() - original_imports.size();
+         remap = [original_functions, added_imports]( uint32_t index ) {
+            return index < original_functions ? index : index + added_imports;
+         };
+         imported_functions += added_imports;
+
+         write_types();
+         write_imports();
+         const uint32_t apply = rewrite_exports();
+         write_globals();
+         rewrite_start();
+         rewrite_elements();
+         rewrite_code( apply );
+
+         instrumented_module result;
+         result.counters = counters;
+         result.wasm = { 0x00, 0x61, 0x73, 0x6d, 0x01, 0x00, 0x00, 0x00 };
+         for( const auto& s : sections ) {
+            // function indices have moved, the names section would be misleading
+            if( s.id == custom_section && s.name == "name" ) continue;
+            result.wasm.push_back( s.id );
+            std::vector<uint8_t> payload;
+            if( s.id == custom_section ) put_str( payload, s.name );
+            payload.insert( payload.end(), s.payload.begin(), s.payload.end() );
+            put_u32( result.wasm, payload.size() );
+            result.wasm.insert( result.wasm.end(), payload.begin(), payload.end() );
+         }
+         return result;
+      }
+
+   private:
+      const options& opts;
+      std::vector<section> sections;
+
+      std::vector<function_type> types;
+      std::vector<import_entry>  original_imports;
+      std::vector<import_entry>  imports;
+      uint32_t                   imported_functions = 0;
+      uint32_t                   imported_globals   = 0;
+      std::vector<uint32_t>      function_types; ///< of the functions defined by the module
+      std::map<uint32_t, std::string> names;     ///< by function index
+
+      std::vector<counter>       counters;
+      std::vector<uint32_t>      function_counters; ///< counter of each defined function
+      std::map<uint32_t, uint32_t> call_counters;   ///< by index of the imported function
+      std::map<uint32_t, uint32_t> bytes_counters;  ///< by index of the imported function
+      uint32_t                   first_counter_global = 0;
+
+      std::function<uint32_t(uint32_t)> remap;
+
+      section* find_section( uint8_t id ) {
+         for( auto& s : sections ) {
+            if( s.id == id ) return &s;
+         }
+         return nullptr;
+      }
+
+      /// returns the section, adding an empty one in the position its id requires when the module has none
+      section& get_section( uint8_t id ) {
+         if( auto* s = find_section( id ) ) return *s;
+         auto itr = std::find_if( sections.begin(), sections.end(), [&]( const section& s ) { return s.id != custom_section && s.id > id; } );
+         section s;
+         s.id = id;
+         put_u32( s.payload, 0 );
+         return *sections.insert( itr, std::move(s) );
+      }
+
+      static reader read( const section& s ) { return reader{ s.payload.data(), s.payload.data() + s.payload.size() }; }
+
+      void read_types() {
+         reader r = read( get_section( type_section ) );
+         for( uint32_t count = r.u32(); count > 0; --count ) {
+            if( r.byte() != 0x60 ) throw error( "invalid function type" );
+            function_type t;
+            for( uint32_t n = r.u32(); n > 0; --n ) t.params.push_back( r.byte() );
+            for( uint32_t n = r.u32(); n > 0; --n ) t.results.push_back( r.byte() );
+            types.push_back( std::move(t) );
+         }
+      }
+
+      void read_imports() {
+         reader r = read( get_section( import_section ) );
+         for( uint32_t count = r.u32(); count > 0; --count ) {
+            import_entry e;
+            e.module = r.str();
+            e.field  = r.str();
+            e.kind   = r.byte();
+            const uint8_t* start = r.pos;
+            switch( e.kind ) {
+               case external_function:
+                  e.type_index = r.u32();
+                  ++imported_functions;
+                  break;
+               case external_table:
+                  r.byte();
+                  if( r.byte() & 1 ) r.u32();
+                  r.u32();
+                  break;
+               case external_memory:
+                  if( r.byte() & 1 ) r.u32();
+                  r.u32();
+                  break;
+               case external_global:
+                  r.byte();
+                  if( r.byte() ) throw error( "mutable global imports are not supported" );
+                  ++imported_globals;
+                  break;
+               default:
+                  throw error( "invalid import kind" );
+            }
+            e.desc.assign( start, r.pos );
+            imports.push_back( e );
+         }
+         original_imports = imports;
+      }
+
+      void read_functions() {
+         if( auto* s = find_section( function_section ) ) {
+            reader r = read( *s );
+            for( uint32_t count = r.u32(); count > 0; --count ) function_types.push_back( r.u32() );
+         }
+      }
+
+      void read_names() {
+         for( const auto& s : sections ) {
+            if( s.id != custom_section || s.name != "name" ) continue;
+            reader r = read( s );
+            while( !r.done() ) {
+               const uint8_t id = r.byte();
+               const uint32_t size = r.u32();
+               reader sub{ r.take( size ), r.pos };
+               if( id != 1 ) continue;
+               for( uint32_t count = sub.u32(); count > 0; --count ) {
+                  const uint32_t index = sub.u32();
+                  names[index] = sub.str();
+               }
+            }
+         }
+         if( auto* s = find_section( export_section ) ) {
+            reader r = read( *s );
+            for( uint32_t count = r.u32(); count > 0; --count ) {
+               const std::string name = r.str();
+               const uint8_t kind = r.byte();
+               const uint32_t index = r.u32();
+               if( kind == external_function ) names.emplace( index, name );
+            }
+         }
+      }
+
+      std::string function_name( uint32_t index )const {
+         auto itr = names.find( index );
+         return itr != names.end() ? itr->second : "function" + std::to_string( index );
+      }
+
+      void assign_counters() {
+         uint32_t mutable_bytes = 0;
+         if( auto* s = find_section( global_section ) ) {
+            reader r = read( *s );
+            for( uint32_t count = r.u32(); count > 0; --count ) {
+               const uint8_t type = r.byte();
+               if( r.byte() ) mutable_bytes += ( type == i64 || type == f64 ) ? 8 : 4;
+               skip_init_expr( r );
+            }
+         }
+         uint32_t available = std::min( opts.max_counters, ( max_mutable_global_bytes - std::min( mutable_bytes, max_mutable_global_bytes ) ) / 4 );
+
+         // the last argument of these is the size of the serialized row
+         static const char* const serializing[] = { "db_store_i64", "db_update_i64", "db_get_i64" };
+         uint32_t index = 0;
+         for( const auto& e : imports ) {
+            if( e.kind != external_function ) continue;
+            for( const auto& prefix : opts.imports ) {
+               if( e.field.compare( 0, prefix.size(), prefix ) != 0 || call_counters.count( index ) ) continue;
+               call_counters[index] = counters.size();
+               counters.push_back( counter{ e.field, counter_kind::calls } );
+               if( std::find( std::begin(serializing), std::end(serializing), e.field ) != std::end(serializing) ) {
+                  bytes_counters[index] = counters.size();
+                  counters.push_back( counter{ e.field, counter_kind::bytes } );
+               }
+            }
+            ++index;
+         }
+         if( available <= counters.size() ) throw error( "not enough mutable globals left for the counters" );
+         available -= counters.size();
+
+         std::vector<bool> selected( function_types.size(), opts.functions.empty() );
+         uint32_t selected_count = 0;
+         for( size_t j = 0; j < function_types.size(); ++j ) {
+            const std::string name = function_name( imported_functions + j );
+            for( const auto& f : opts.functions ) {
+               if( name.find( f ) != std::string::npos ) selected[j] = true;
+            }
+            selected_count += selected[j];
+         }
+         const bool needs_other = selected_count < function_types.size() || selected_count > available;
+         const uint32_t own = std::min<uint32_t>( selected_count, needs_other ? available - 1 : available );
+
+         // the functions without a counter of their own share the last one
+         const uint32_t first = counters.size();
+         const uint32_t other = first + own;
+         for( size_t j = 0; j < function_types.size(); ++j ) {
+            if( selected[j] && counters.size() < other ) {
+               function_counters.push_back( counters.size() );
+               counters.push_back( counter{ function_name( imported_functions + j ), counter_kind::instructions } );
+            } else {
+               function_counters.push_back( other );
+            }
+         }
+         if( needs_other ) {
+            counters.push_back( counter{ "<other>", counter_kind::instructions } );
+         }
+      }
+
+      static void skip_init_expr( reader& r ) {
+         for( uint8_t op = r.byte(); op != op_end; op = r.byte() ) {
+            if( op == op_f32_const ) r.take( 4 );
+            else if( op == op_f64_const ) r.take( 8 );
+            else r.skip_leb();
+         }
+      }
+
+      uint32_t type_index( const function_type& t ) {
+         auto itr = std::find( types.begin(), types.end(), t );
+         if( itr != types.end() ) return itr - types.begin();
+         types.push_back( t );
+         return types.size() - 1;
+      }
+
+      /// adds an "env" function import of type (i64)->() unless the module already imports it
+      void add_import( const std::string& field ) {
+         for( const auto& e : imports ) {
+            if( e.kind == external_function && e.module == "env" && e.field == field ) return;
+         }
+         import_entry e;
+         e.module = "env";
+         e.field  = field;
+         e.kind   = external_function;
+         e.type_index = type_index( function_type{ { i64 }, {} } );
+         e.desc.clear();
+         put_u32( e.desc, e.type_index );
+         imports.push_back( e );
+      }
+
+      /// index of an "env" function import in the final function index space
+      uint32_t import_index( const std::string& field ) {
+         uint32_t index = 0;
+         for( const auto& e : imports ) {
+            if( e.kind != external_function ) continue;
+            if( e.module == "env" && e.field == field ) return index;
+            ++index;
+         }
+         throw error( "missing import " + field );
+      }
+
+      void write_types() {
+         // the type of apply, used by the replacement
+         type_index( function_type{ { i64, i64, i64 }, {} } );
+         auto& s = get_section( type_section );
+         s.payload.clear();
+         put_u32( s.payload, types.size() );
+         for( const auto& t : types ) {
+            s.payload.push_back( 0x60 );
+            put_u32( s.payload, t.params.size() );
+            s.payload.insert( s.payload.end(), t.params.begin(), t.params.end() );
+            put_u32( s.payload, t.results.size() );
+            s.payload.insert( s.payload.end(), t.results.begin(), t.results.end() );
+         }
+      }
+
+      void write_imports() {
+         // function imports precede the defined functions, so the added ones keep the index space contiguous
+         auto& s = get_section( import_section );
+         s.payload.clear();
+         put_u32( s.payload, imports.size() );
+         for( const auto& e : imports ) {
+            put_str( s.payload, e.module );
+            put_str( s.payload, e.field );
+            s.payload.push_back( e.kind );
+            s.payload.insert( s.payload.end(), e.desc.begin(), e.desc.end() );
+         }
+      }
+
+      /// points the "apply" export at the replacement and returns the remapped index of the original apply
+      uint32_t rewrite_exports() {
+         auto* s = find_section( export_section );
+         if( !s ) throw error( "module does not export apply" );
+         reader r = read( *s );
+         std::vector<uint8_t> out;
+         uint32_t apply = uint32_t(-1);
+         const uint32_t count = r.u32();
+         put_u32( out, count );
+         for( uint32_t i = 0; i < count; ++i ) {
+            const std::string name = r.str();
+            const uint8_t kind = r.byte();
+            uint32_t index = r.u32();
+            if( kind == external_function ) {
+               index = remap( index );
+               if( name == "apply" ) {
+                  apply = index;
+                  index = imported_functions + function_types.size();
+               }
+            }
+            put_str( out, name );
+            out.push_back( kind );
+            put_u32( out, index );
+         }
+         if( apply == uint32_t(-1) ) throw error( "module does not export apply" );
+         s->payload = std::move(out);
+         return apply;
+      }
+
+      void write_globals() {
+         auto& s = get_section( global_section );
+         reader r = read( s );
+         uint32_t count = r.u32();
+         first_counter_global = imported_globals + count;
+         std::vector<uint8_t> out;
+         put_u32( out, count + counters.size() );
+         put_bytes( out, r.pos, r.end );
+         for( size_t i = 0; i < counters.size(); ++i ) {
+            out.insert( out.end(), { i32, 0x01, op_i32_const, 0x00, op_end } );
+         }
+         s.payload = std::move(out);
+      }
+
+      void rewrite_start() {
+         if( auto* s = find_section( start_section ) ) {
+            reader r = read( *s );
+            const uint32_t index = r.u32();
+            s->payload.clear();
+            put_u32( s->payload, remap( index ) );
+         }
+      }
+
+      void rewrite_elements() {
+         auto* s = find_section( element_section );
+         if( !s ) return;
+         reader r = read( *s );
+         std::vector<uint8_t> out;
+         const uint32_t count = r.u32();
+         put_u32( out, count );
+         for( uint32_t i = 0; i < count; ++i ) {
+            put_u32( out, r.u32() );
+            const uint8_t* start = r.pos;
+            skip_init_expr( r );
+            put_bytes( out, start, r.pos );
+            const uint32_t functions = r.u32();
+            put_u32( out, functions );
+            for( uint32_t j = 0; j < functions; ++j ) put_u32( out, remap( r.u32() ) );
+         }
+         s->payload = std::move(out);
+      }
+
+      void add_to_counter( std::vector<uint8_t>& out, uint32_t counter, uint32_t amount ) {
+         const uint32_t global = first_counter_global + counter;
+         out.push_back( op_global_get );
+         put_u32( out, global );
+         out.push_back( op_i32_const );
+         put_s64( out, amount );
+         out.push_back( op_i32_add );
+         out.push_back( op_global_set );
+         put_u32( out, global );
+      }
+
+      /**
+       * Copies the instructions of a function body, remapping the called functions, and adds the length of
+       * each straight line sequence to 'counter' at the start of the sequence. The size argument of the
+       * serializing database calls is saved in the i32 local 'scratch', which is only declared by the caller
+       * when 'uses_scratch' is set.
+       */
+      std::vector<uint8_t> instrument_body( reader& r, uint32_t counter, uint32_t scratch, bool& uses_scratch ) {
+         std::vector<uint8_t> out;
+         std::vector<uint8_t> sequence;
+         uint32_t length = 0;
+         auto end_sequence = [&]() {
+            add_to_counter( out, counter, length );
+            out.insert( out.end(), sequence.begin(), sequence.end() );
+            sequence.clear();
+            length = 0;
+         };
+
+         uint32_t depth = 1;
+         while( depth > 0 ) {
+            const uint8_t* start = r.pos;
+            const uint8_t op = r.byte();
+            ++length;
+            bool ends_sequence = false;
+            switch( op ) {
+               case op_block: case op_loop: case op_if:
+                  r.byte();
+                  ++depth;
+                  ends_sequence = true;
+                  break;
+               case op_end:
+                  --depth;
+                  ends_sequence = true;
+                  break;
+               case op_unreachable: case op_else: case op_return:
+                  ends_sequence = true;
+                  break;
+               case op_br: case op_br_if:
+                  r.u32();
+                  ends_sequence = true;
+                  break;
+               case op_br_table:
+                  for( uint32_t n = r.u32(); n > 0; --n ) r.u32();
+                  r.u32();
+                  ends_sequence = true;
+                  break;
+               case op_call: {
+                  const uint32_t function = r.u32();
+                  auto bytes = bytes_counters.find( function );
+                  if( bytes != bytes_counters.end() ) {
+                     const uint32_t global = first_counter_global + bytes->second;
+                     sequence.push_back( op_local_tee );
+                     put_u32( sequence, scratch );
+                     sequence.push_back( op_global_get );
+                     put_u32( sequence, global );
+                     sequence.push_back( op_local_get );
+                     put_u32( sequence, scratch );
+                     sequence.push_back( op_i32_add );
+                     sequence.push_back( op_global_set );
+                     put_u32( sequence, global );
+                     uses_scratch = true;
+                  }
+                  auto calls = call_counters.find( function );
+                  if( calls != call_counters.end() ) {
+                     add_to_counter( sequence, calls->second, 1 );
+                  }
+                  sequence.push_back( op );
+                  put_u32( sequence, remap( function ) );
+                  continue;
+               }
+               case op_call_indirect:
+                  r.u32();
+                  r.byte();
+                  break;
+               case op_local_get: case op_local_set: case op_local_tee: case op_global_get: case op_global_set:
+                  r.u32();
+                  break;
+               case op_memory_size: case op_memory_grow:
+                  r.byte();
+                  break;
+               case op_i32_const: case op_i64_const:
+                  r.skip_leb();
+                  break;
+               case op_f32_const:
+                  r.take( 4 );
+                  break;
+               case op_f64_const:
+                  r.take( 8 );
+                  break;
+               default:
+                  if( op >= op_i32_load && op <= op_i64_store32 ) {
+                     r.u32();
+                     r.u32();
+                  } else if( op > op_last_numeric || ( op > op_else && op < op_end ) || ( op > op_return && op < 0x1a ) || ( op > 0x1b && op < op_local_get )
+                             || ( op > op_global_set && op < op_i32_load ) ) {
+                     throw error( "unsupported opcode " + std::to_string( op ) );
+                  }
+            }
+            put_bytes( sequence, start, r.pos );
+            if( ends_sequence ) end_sequence();
+         }
+         if( !r.done() ) throw error( "trailing bytes after function body" );
+         return out;
+      }
+
+      /// calls the original apply and then prints the counters which are not zero
+      std::vector<uint8_t> apply_body( uint32_t apply ) {
+         std::vector<uint8_t> out;
+         put_u32( out, 0 ); // no locals
+         for( uint8_t i = 0; i < 3; ++i ) out.insert( out.end(), { op_local_get, i } );
+         out.push_back( op_call );
+         put_u32( out, apply );
+
+         const uint32_t printn  = import_index( "printn" );
+         const uint32_t printui = import_index( "printui" );
+         auto print = [&]( uint32_t function, uint64_t value ) {
+            out.push_back( op_i64_const );
+            put_s64( out, int64_t(value) );
+            out.push_back( op_call );
+            put_u32( out, function );
+         };
+         print( printn, name_value( console_marker ) );
+         for( uint32_t c = 0; c < counters.size(); ++c ) {
+            out.push_back( op_global_get );
+            put_u32( out, first_counter_global + c );
+            out.insert( out.end(), { op_if, 0x40 } );
+            print( printui, c );
+            print( printn, name_value( "i" ) );
+            out.push_back( op_global_get );
+            put_u32( out, first_counter_global + c );
+            out.push_back( op_i64_extend_i32_u );
+            out.push_back( op_call );
+            put_u32( out, printui );
+            print( printn, name_value( "x" ) );
+            out.push_back( op_end );
+         }
+         out.push_back( op_end );
+         return out;
+      }
+
+      void rewrite_code( uint32_t apply ) {
+         auto& s = get_section( code_section );
+         reader r = read( s );
+         const uint32_t count = r.u32();
+         if( count != function_types.size() ) throw error( "function and code sections do not match" );
+
+         std::vector<uint8_t> out;
+         put_u32( out, count + 1 );
+         for( uint32_t j = 0; j < count; ++j ) {
+            const uint32_t size = r.u32();
+            reader body{ r.take( size ), r.pos };
+            const uint32_t declarations = body.u32();
+            const uint8_t* locals = body.pos;
+            uint32_t scratch = types.at( function_types[j] ).params.size();
+            for( uint32_t n = declarations; n > 0; --n ) {
+               scratch += body.u32();
+               body.byte();
+            }
+            const uint8_t* locals_end = body.pos;
+
+            bool uses_scratch = false;
+            const auto instructions = instrument_body( body, function_counters[j], scratch, uses_scratch );
+            std::vector<uint8_t> code;
+            put_u32( code, declarations + uses_scratch );
+            put_bytes( code, locals, locals_end );
+            if( uses_scratch ) code.insert( code.end(), { 0x01, i32 } );
+            code.insert( code.end(), instructions.begin(), instructions.end() );
+            put_u32( out, code.size() );
+            out.insert( out.end(), code.begin(), code.end() );
+         }
+         const auto replacement = apply_body( apply );
+         put_u32( out, replacement.size() );
+         out.insert( out.end(), replacement.begin(), replacement.end() );
+         s.payload = std::move(out);
+
+         auto& functions = get_section( function_section );
+         reader f = read( functions );
+         f.u32();
+         std::vector<uint8_t> declared;
+         put_u32( declared, count + 1 );
+         put_bytes( declared, f.pos, f.end );
+         put_u32( declared, type_index( function_type{ { i64, i64, i64 }, {} } ) );
+         functions.payload = std::move(declared);
+      }
+   };
+
+} /// namespace
+
+instrumented_module instrument( const std::vector<uint8_t>& wasm, const options& opts ) {
+   return instrumenter( wasm, opts ).run();
+}
+
+std::vector<uint64_t> parse_console( const std::string& console, size_t counters ) {
+   std::vector<uint64_t> result( counters );
+   const size_t marker = console.rfind( console_marker );
+   if( marker == std::string::npos ) return result;
+
+   const char* p = console.c_str() + marker + std::string( console_marker ).size();
+   while( *p ) {
+      char* next = nullptr;
+      const unsigned long long counter = std::strtoull( p, &next, 10 );
+      if( next == p || *next != 'i' ) break;
+      p = next + 1;
+      const unsigned long long count = std::strtoull( p, &next, 10 );
+      if( next == p || *next != 'x' || counter >= counters ) break;
+      p = next + 1;
+      result[counter] = count;
+   }
+   return result;
+}
+
+} /// wasm_profiler
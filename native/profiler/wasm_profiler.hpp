@@ -0,0 +1,61 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+/**
+ * Instruments a contract so that it counts the wasm instructions executed by each of its functions. The counts
+ * are deterministic, unlike the billed cpu, so they can be compared between builds of a contract.
+ *
+ * Every straight line sequence of instructions adds its length to a mutable global of its function when it is
+ * entered, calls to the selected imports, such as the database intrinsics, are counted with the bytes they
+ * serialize, and the exported apply is replaced by a function which calls it and then prints the non zero
+ * counters to the console of the action. The counters start at zero for every action since the globals of a
+ * contract are reset before each apply.
+ */
+namespace wasm_profiler {
+
+   enum class counter_kind {
+      instructions, ///< executed by a function of the contract
+      calls,        ///< to an imported function
+      bytes         ///< passed to db_store_i64, db_update_i64 or db_get_i64
+   };
+
+   struct counter {
+      std::string  name; ///< of the function, "<other>" for the functions sharing an instruction counter
+      counter_kind kind;
+   };
+
+   struct options {
+      std::vector<std::string> functions;                 ///< substrings of the names of the functions which get their own counter, all when empty
+      std::vector<std::string> imports = { "db_" };       ///< prefixes of the names of the imported functions whose calls are counted
+      uint32_t                 max_counters = 255;        ///< eosio limits the mutable globals of a contract to 1024 bytes
+   };
+
+   struct instrumented_module {
+      std::vector<uint8_t> wasm;
+      std::vector<counter> counters; ///< in the order of the indices printed by apply
+   };
+
+   /// printed before the counters, the console of an action ends with "wasmprofile" followed by "<counter>i<count>x" for each counter
+   extern const char* const console_marker;
+
+   /**
+    * Function names are read from the "name" section, exported functions without one are named after their export
+    * and the remaining ones "function<index>". Throws std::runtime_error if the module cannot be instrumented.
+    */
+   instrumented_module instrument( const std::vector<uint8_t>& wasm, const options& opts = options() );
+
+   /**
+    * Counts printed at the end of the console of an action by a module instrumented with 'counters' counters,
+    * indexed like the counters
+    */
+   std::vector<uint64_t> parse_console( const std::string& console, size_t counters );
+
+} /// wasm_profiler
@@ -0,0 +1,240 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Replays a stream of ram trades through exchange_state with the fee and ram supply rules of
+ *  buyram, buyrambytes, sellram and setramrate in eosio.system, and reports throughput, the
+ *  price trajectory, rounding leakage and the fees collected.
+ *
+ *  Each line of the stream is "<block> <action> <account> <amount>", where amount is the token
+ *  quantity for buyram (in the smallest unit), the number of bytes for buyrambytes and sellram,
+ *  and the bytes per block for setramrate. Empty lines and lines starting with '#' are ignored.
+ */
+#include <eosio.system/exchange_state.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace eosiosystem;
+
+namespace {
+
+   const symbol ramcore_symbol( "RAMCORE", 4 );
+   const symbol ram_symbol( "RAM", 0 );
+   const symbol core_symbol( "SYS", 4 );
+
+   enum class trade_type { buyram, buyrambytes, sellram, setramrate };
+
+   struct trade {
+      uint32_t    block;
+      trade_type  type;
+      std::string account;
+      int64_t     amount;
+   };
+
+   struct options {
+      std::string trades_file;
+      std::string price_csv;
+      int64_t     ram_bytes   = 64ll * 1024 * 1024 * 1024;
+      int64_t     core_supply = 100000000000000ll;
+   };
+
+   bool parse_options( int argc, char** argv, options& opts ) {
+      for( int i = 1; i < argc; ++i ) {
+         if( !std::strcmp( argv[i], "--price-csv" ) && i + 1 < argc ) {
+            opts.price_csv = argv[++i];
+         } else if( !std::strcmp( argv[i], "--ram-bytes" ) && i + 1 < argc ) {
+            opts.ram_bytes = std::strtoll( argv[++i], nullptr, 10 );
+         } else if( !std::strcmp( argv[i], "--core-supply" ) && i + 1 < argc ) {
+            opts.core_supply = std::strtoll( argv[++i], nullptr, 10 );
+         } else if( argv[i][0] != '-' && opts.trades_file.empty() ) {
+            opts.trades_file = argv[i];
+         } else {
+            opts.trades_file.clear();
+            break;
+         }
+      }
+      if( opts.trades_file.empty() ) {
+         std::cerr << "usage: " << argv[0] << " <trades file> [--price-csv FILE] [--ram-bytes N] [--core-supply N]" << std::endl;
+         return false;
+      }
+      return true;
+   }
+
+   bool load_trades( const std::string& path, std::vector<trade>& trades ) {
+      static const std::map<std::string, trade_type> types = {
+         { "buyram",      trade_type::buyram },
+         { "buyrambytes", trade_type::buyrambytes },
+         { "sellram",     trade_type::sellram },
+         { "setramrate",  trade_type::setramrate }
+      };
+
+      std::ifstream in( path );
+      if( !in ) {
+         std::cerr << "error: cannot open " << path << std::endl;
+         return false;
+      }
+
+      std::string line;
+      for( uint32_t line_num = 1; std::getline( in, line ); ++line_num ) {
+         if( line.empty() || line[0] == '#' )
+            continue;
+
+         std::istringstream fields( line );
+         trade t;
+         std::string action;
+         if( !( fields >> t.block >> action >> t.account >> t.amount ) || types.count( action ) == 0 || t.amount <= 0 ) {
+            std::cerr << "error: " << path << ":" << line_num << ": invalid trade '" << line << "'" << std::endl;
+            return false;
+         }
+         if( !trades.empty() && t.block < trades.back().block ) {
+            std::cerr << "error: " << path << ":" << line_num << ": blocks must not decrease" << std::endl;
+            return false;
+         }
+         t.type = types.at( action );
+         trades.push_back( t );
+      }
+      return true;
+   }
+
+   /// state kept by the system contract for the ram market
+   struct ram_market {
+      exchange_state market;
+      uint16_t       new_ram_per_block = 0;
+      uint32_t       last_ram_increase = 0;
+      std::map<std::string, int64_t> ram_bytes;
+
+      int64_t fees      = 0;
+      int64_t rejected  = 0;
+      double  leaked_bytes  = 0; ///< bytes lost to truncation on buys, relative to the exact market formula
+      double  leaked_tokens = 0; ///< tokens lost to truncation on sells, relative to the exact market formula
+
+      /// same as system_contract::new_ram_supply
+      int64_t new_ram_supply( uint32_t block ) {
+         if( block <= last_ram_increase ) return 0;
+         const int64_t new_ram = int64_t( block - last_ram_increase ) * new_ram_per_block;
+         last_ram_increase = block;
+         return new_ram;
+      }
+
+      void apply( const trade& t ) {
+         market.base.balance.amount += new_ram_supply( t.block );
+         const long double base  = market.base.balance.amount;
+         const long double quote = market.quote.balance.amount;
+
+         switch( t.type ) {
+            case trade_type::buyram: {
+               const int64_t fee = ( t.amount + 199 ) / 200;
+               const int64_t quant_after_fee = t.amount - fee;
+               exchange_state m = market;
+               const int64_t bytes_out = m.convert( asset( quant_after_fee, core_symbol ), ram_symbol ).amount;
+               if( bytes_out <= 0 ) { ++rejected; return; }
+               market = m;
+               ram_bytes[t.account] += bytes_out;
+               fees += fee;
+               leaked_bytes += double( base * quant_after_fee / ( quote + quant_after_fee ) - bytes_out );
+               break;
+            }
+            case trade_type::buyrambytes: {
+               if( t.amount >= market.base.balance.amount ) { ++rejected; return; }
+               const int64_t cost = exchange_state::get_bancor_input( market.base.balance.amount, market.quote.balance.amount, t.amount );
+               market.base.balance.amount  -= t.amount;
+               market.quote.balance.amount += cost;
+               ram_bytes[t.account] += t.amount;
+               fees += ( cost + 198 ) / 199;
+               break;
+            }
+            case trade_type::sellram: {
+               auto& held = ram_bytes[t.account];
+               if( held < t.amount ) { ++rejected; return; }
+               exchange_state m = market;
+               const int64_t tokens_out = m.convert( asset( t.amount, ram_symbol ), core_symbol ).amount;
+               if( tokens_out <= 1 ) { ++rejected; return; }
+               market = m;
+               held -= t.amount;
+               fees += ( tokens_out + 199 ) / 200;
+               leaked_tokens += double( quote * t.amount / ( base + t.amount ) - tokens_out );
+               break;
+            }
+            case trade_type::setramrate:
+               new_ram_per_block = uint16_t( std::min<int64_t>( t.amount, UINT16_MAX ) );
+               break;
+         }
+      }
+
+      /// tokens received by selling 1 KiB before the sell fee, as published in the ramprice table
+      int64_t sell_price_per_kb()const {
+         exchange_state m = market;
+         return m.convert( asset( 1024, ram_symbol ), core_symbol ).amount;
+      }
+   };
+
+} /// namespace
+
+int main( int argc, char** argv ) {
+   options opts;
+   if( !parse_options( argc, argv, opts ) )
+      return 2;
+
+   std::vector<trade> trades;
+   if( !load_trades( opts.trades_file, trades ) )
+      return 2;
+
+   ram_market sim;
+   sim.market.supply        = asset( 100000000000000ll, ramcore_symbol );
+   sim.market.base.balance  = asset( opts.ram_bytes, ram_symbol );
+   sim.market.quote.balance = asset( opts.core_supply / 1000, core_symbol );
+   const exchange_state initial = sim.market;
+
+   std::vector<std::pair<uint32_t, int64_t>> prices;
+   prices.emplace_back( trades.empty() ? 0 : trades.front().block, sim.sell_price_per_kb() );
+
+   const auto start = std::chrono::steady_clock::now();
+   for( size_t i = 0; i < trades.size(); ++i ) {
+      sim.apply( trades[i] );
+      if( i + 1 == trades.size() || trades[i + 1].block != trades[i].block )
+         prices.emplace_back( trades[i].block, sim.sell_price_per_kb() );
+   }
+   const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+   const auto minmax = std::minmax_element( prices.begin(), prices.end(),
+                                            []( const auto& a, const auto& b ) { return a.second < b.second; } );
+   int64_t outstanding = 0;
+   for( const auto& held : sim.ram_bytes )
+      outstanding += held.second;
+
+   std::cout << "trades:              " << trades.size() << " (" << sim.rejected << " rejected)" << std::endl;
+   std::cout << "throughput:          " << ( elapsed.count() > 0 ? trades.size() / elapsed.count() : 0 ) << " trades/s" << std::endl;
+   std::cout << "price per KiB:       first " << prices.front().second << ", last " << prices.back().second
+             << ", min " << minmax.first->second << " (block " << minmax.first->first << ")"
+             << ", max " << minmax.second->second << " (block " << minmax.second->first << ")" << std::endl;
+   std::cout << "ram added by rate:   " << sim.market.base.balance.amount + outstanding - initial.base.balance.amount << " bytes" << std::endl;
+   std::cout << "supply drift:        " << sim.market.supply.amount - initial.supply.amount << std::endl;
+   std::cout << "rounding leakage:    " << sim.leaked_bytes << " bytes on buys, " << sim.leaked_tokens << " tokens on sells" << std::endl;
+   std::cout << "fees collected:      " << sim.fees << std::endl;
+
+   if( !opts.price_csv.empty() ) {
+      std::ofstream csv( opts.price_csv );
+      csv << "block,sell_price_per_kb\n";
+      for( const auto& p : prices )
+         csv << p.first << "," << p.second << "\n";
+   }
+
+   if( sim.market.base.balance.amount <= 0 || sim.market.quote.balance.amount <= 0 ) {
+      std::cerr << "error: market connector balance is not positive" << std::endl;
+      return 1;
+   }
+   if( sim.leaked_bytes < -1 || sim.leaked_tokens < -1 ) {
+      std::cerr << "error: market rounding favors traders" << std::endl;
+      return 1;
+   }
+   return 0;
+}
@@ -0,0 +1,71 @@
+# Lists the tests of a Boost.Test executable with --list_content and writes a ctest file which registers
+# each test case, or each top level test suite when SHARD_BY is "suite", as a separate test.
+#
+# Run in script mode with:
+#   TEST_EXECUTABLE  the Boost.Test executable
+#   CTEST_FILE       the ctest file to write
+#   SHARD_BY         "case" or "suite"
+#   TEST_ARGS        arguments passed to the tests after "--", separated by "|"
+
+execute_process( COMMAND ${TEST_EXECUTABLE} --list_content
+                 OUTPUT_VARIABLE output
+                 ERROR_VARIABLE  output
+                 RESULT_VARIABLE result )
+if( NOT result EQUAL 0 )
+   message( FATAL_ERROR "Listing the tests of ${TEST_EXECUTABLE} failed:\n${output}" )
+endif()
+
+# Each test unit is printed on its own line, indented by 4 spaces per level and followed by '*' when enabled
+string( REPLACE ";" "" output "${output}" )
+string( REPLACE "\n" ";" lines "${output}" )
+set( depths "" )
+set( names "" )
+foreach( line IN LISTS lines )
+   if( line MATCHES "^( *)([A-Za-z_][A-Za-z0-9_]*)\\*?$" )
+      string( LENGTH "${CMAKE_MATCH_1}" indent )
+      math( EXPR depth "${indent} / 4" )
+      list( APPEND depths ${depth} )
+      list( APPEND names ${CMAKE_MATCH_2} )
+   endif()
+endforeach()
+
+string( REPLACE "|" ";" test_args "${TEST_ARGS}" )
+set( content "# Generated by DiscoverBoostTests.cmake from ${TEST_EXECUTABLE}\n" )
+set( path "" )
+list( LENGTH names count )
+set( index 0 )
+while( index LESS count )
+   list( GET depths ${index} depth )
+   list( GET names ${index} name )
+   math( EXPR next "${index} + 1" )
+
+   # drop the parents that are not above this unit anymore
+   list( LENGTH path path_length )
+   while( path_length GREATER depth )
+      math( EXPR last "${path_length} - 1" )
+      list( REMOVE_AT path ${last} )
+      list( LENGTH path path_length )
+   endwhile()
+   list( APPEND path ${name} )
+
+   set( is_suite FALSE )
+   if( next LESS count )
+      list( GET depths ${next} next_depth )
+      if( next_depth GREATER depth )
+         set( is_suite TRUE )
+      endif()
+   endif()
+
+   if( ( SHARD_BY STREQUAL "suite" AND depth EQUAL 0 ) OR ( NOT SHARD_BY STREQUAL "suite" AND NOT is_suite ) )
+      string( REPLACE ";" "/" test_name "${path}" )
+      set( content "${content}add_test( [==[${test_name}]==] [==[${TEST_EXECUTABLE}]==] [==[--run_test=${test_name}]==] --report_level=no --" )
+      foreach( arg IN LISTS test_args )
+         set( content "${content} [==[${arg}]==]" )
+      endforeach()
+      set( content "${content} )\n" )
+   endif()
+
+   set( index ${next} )
+endwhile()
+
+file( WRITE ${CTEST_FILE} "${content}" )
@@ -0,0 +1,464 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#pragma once
+
+#include "eosio.system_tester.hpp"
+
+#include <eosio/chain/contract_table_objects.hpp>
+
+#include <wasm_profiler.hpp>
+
+#include <fc/io/json.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+
+namespace eosio_system {
+
+/**
+ * Wasm instructions executed by a function of a contract instrumented by eosio_benchmark_tester::profile_contract
+ */
+struct function_cost {
+   std::string contract;
+   std::string function;
+   uint64_t    instructions = 0;
+};
+
+/**
+ * Calls of a database intrinsic by a contract instrumented by eosio_benchmark_tester::profile_contract
+ */
+struct intrinsic_cost {
+   std::string contract;
+   std::string intrinsic;
+   uint64_t    calls = 0;
+   uint64_t    bytes = 0; ///< size of the rows passed to db_store_i64, db_update_i64 and db_get_i64
+};
+
+/**
+ * Resources billed for one action, measured from the trace of the transaction which contains only that action
+ */
+struct action_cost {
+   std::string scenario;
+   std::string action;          ///< "<contract>::<action>"
+   uint32_t    cpu_usage_us = 0;
+   uint32_t    elapsed_us   = 0; ///< wall clock time, only recorded for onblock which is not billed cpu
+   uint64_t    net_usage    = 0;
+   int64_t     ram_delta    = 0; ///< ram bytes billed by the transaction, summed over all accounts
+   uint32_t    inline_actions = 0;
+   uint64_t    instructions   = 0; ///< executed by the profiled contracts, including inline actions
+   std::vector<function_cost> functions; ///< most expensive first
+   std::vector<intrinsic_cost> intrinsics;
+};
+
+/**
+ * Rows and ram of a contract table, summed over all of its scopes
+ */
+struct table_footprint {
+   std::string contract;
+   std::string table;
+   uint32_t    scopes            = 0;
+   uint64_t    rows              = 0;
+   uint64_t    secondary_rows    = 0; ///< in all secondary indices of the table
+   uint64_t    data_bytes        = 0; ///< serialized rows
+   uint64_t    billed_bytes      = 0; ///< ram billed to the payers, including the overhead of every table, row and index entry
+   double      average_row_bytes = 0; ///< serialized bytes per row
+};
+
+/**
+ * Maximum resources an action may be billed, an absent or null limit is not checked
+ */
+struct action_budget {
+   fc::optional<uint32_t> cpu_usage_us;
+   fc::optional<uint64_t> net_usage;
+   fc::optional<int64_t>  ram_delta; ///< zero or negative limits require the action to free ram
+};
+
+} /// eosio_system
+
+FC_REFLECT( eosio_system::function_cost, (contract)(function)(instructions) )
+FC_REFLECT( eosio_system::intrinsic_cost, (contract)(intrinsic)(calls)(bytes) )
+FC_REFLECT( eosio_system::action_cost, (scenario)(action)(cpu_usage_us)(elapsed_us)(net_usage)(ram_delta)(inline_actions)(instructions)(functions)(intrinsics) )
+FC_REFLECT( eosio_system::action_budget, (cpu_usage_us)(net_usage)(ram_delta) )
+FC_REFLECT( eosio_system::table_footprint, (contract)(table)(scopes)(rows)(secondary_rows)(data_bytes)(billed_bytes)(average_row_bytes) )
+
+namespace eosio_system {
+
+/**
+ * Precondition of test units which only run when the environment variable is set, used by the long running benchmarks
+ */
+struct env_is_set {
+   const char* name;
+
+   boost::test_tools::assertion_result operator()( boost::unit_test::test_unit_id )const {
+      boost::test_tools::assertion_result result( std::getenv( name ) != nullptr );
+      result.message() << name << " is not set";
+      return result;
+   }
+};
+
+/**
+ * Reads an unsigned integer setting of a benchmark from the environment
+ */
+inline uint64_t env_uint( const char* name, uint64_t default_value ) {
+   const char* value = std::getenv( name );
+   return value ? std::strtoull( value, nullptr, 10 ) : default_value;
+}
+
+class eosio_benchmark_tester : public eosio_system_tester {
+public:
+   using eosio_system_tester::eosio_system_tester;
+
+   /**
+    * Pushes a single action in its own block and records what it was billed
+    */
+   transaction_trace_ptr measure( const std::string& scenario, const account_name& code, const action_name& act,
+                                  const account_name& signer, const variant_object& data ) {
+      auto trace = push_billed_action( code, act, signer, data );
+      produce_block();
+      record( scenario, code, act, trace );
+      return trace;
+   }
+
+   /**
+    * Pushes a single action in its own transaction billed with the cpu it actually used, the tester otherwise bills
+    * every transaction a fixed cpu time. Identical actions pushed in one block need distinct expiration deltas.
+    */
+   transaction_trace_ptr push_billed_action( const account_name& code, const action_name& act, const account_name& signer,
+                                             const variant_object& data, uint32_t expiration_delta = DEFAULT_EXPIRATION_DELTA ) {
+      signed_transaction trx;
+      trx.actions.emplace_back( get_action( code, act, vector<permission_level>{ { signer, config::active_name } }, data ) );
+      set_transaction_headers( trx, expiration_delta );
+      trx.sign( get_private_key( signer, "active" ), control->get_chain_id() );
+      return push_transaction( trx, fc::time_point::maximum(), 0 );
+   }
+
+   void record( const std::string& scenario, const account_name& code, const action_name& act, const transaction_trace_ptr& trace ) {
+      BOOST_REQUIRE( bool(trace->receipt) );
+
+      action_cost cost;
+      cost.scenario     = scenario;
+      cost.action       = code.to_string() + "::" + act.to_string();
+      cost.cpu_usage_us = trace->receipt->cpu_usage_us;
+      cost.net_usage    = trace->net_usage;
+      for( const auto& at : trace->action_traces ) {
+         cost.ram_delta      += ram_delta( at );
+         cost.inline_actions += inline_actions( at );
+         add_profile( cost, at );
+      }
+      sort_functions( cost );
+      costs.push_back( cost );
+   }
+
+   /**
+    * Replaces the code of 'account' with a copy which counts the wasm instructions executed by each function and
+    * the calls of the database intrinsics. The counts are deterministic and are recorded with the cost of every
+    * action the contract runs.
+    */
+   void profile_contract( const account_name& account, const wasm_profiler::options& opts = wasm_profiler::options() ) {
+      const auto& accnt = control->db().get<account_object,by_name>( account );
+      auto profiled = wasm_profiler::instrument( std::vector<uint8_t>( accnt.code.begin(), accnt.code.end() ), opts );
+      set_code( account, profiled.wasm );
+      profiled_contracts[account] = std::move( profiled.counters );
+      produce_block();
+   }
+
+   void add_profile( action_cost& cost, const action_trace& at )const {
+      auto itr = profiled_contracts.find( at.receipt.receiver );
+      if( itr != profiled_contracts.end() ) {
+         const std::string contract = at.receipt.receiver.to_string();
+         const auto& counters = itr->second;
+         const auto counts = wasm_profiler::parse_console( at.console, counters.size() );
+         for( size_t c = 0; c < counters.size(); ++c ) {
+            if( !counts[c] ) continue;
+            if( counters[c].kind == wasm_profiler::counter_kind::instructions ) {
+               cost.instructions += counts[c];
+               auto f = std::find_if( cost.functions.begin(), cost.functions.end(), [&]( const function_cost& existing ) {
+                  return existing.contract == contract && existing.function == counters[c].name;
+               });
+               if( f == cost.functions.end() ) {
+                  cost.functions.push_back( function_cost{ contract, counters[c].name, counts[c] } );
+               } else {
+                  f->instructions += counts[c];
+               }
+            } else {
+               auto i = std::find_if( cost.intrinsics.begin(), cost.intrinsics.end(), [&]( const intrinsic_cost& existing ) {
+                  return existing.contract == contract && existing.intrinsic == counters[c].name;
+               });
+               if( i == cost.intrinsics.end() ) {
+                  i = cost.intrinsics.insert( i, intrinsic_cost{ contract, counters[c].name } );
+               }
+               ( counters[c].kind == wasm_profiler::counter_kind::calls ? i->calls : i->bytes ) += counts[c];
+            }
+         }
+      }
+      for( const auto& inline_trace : at.inline_traces ) {
+         add_profile( cost, inline_trace );
+      }
+   }
+
+   static void sort_functions( action_cost& cost ) {
+      std::sort( cost.functions.begin(), cost.functions.end(), []( const function_cost& a, const function_cost& b ) {
+         return a.instructions > b.instructions;
+      });
+   }
+
+   /// distinct account name for each index below 31^6, e.g. generated_account( "prod", 0 ) is "prodaaaaaa"
+   static account_name generated_account( const std::string& prefix, uint32_t index ) {
+      static const char digits[] = "abcdefghijklmnopqrstuvwxyz12345";
+      std::string suffix;
+      for( int i = 0; i < 6; ++i ) {
+         suffix.insert( suffix.begin(), digits[index % 31] );
+         index /= 31;
+      }
+      return account_name( prefix + suffix );
+   }
+
+   /**
+    * Creates the accounts in batches, each staking 'stake' for net and cpu which is transferred by eosio
+    */
+   void create_staked_accounts( const std::vector<account_name>& accounts, const asset& stake, size_t batch = 20 ) {
+      for( size_t i = 0; i < accounts.size(); i += batch ) {
+         signed_transaction trx;
+         set_transaction_headers( trx );
+         for( size_t j = i; j < std::min( accounts.size(), i + batch ); ++j ) {
+            const auto& a = accounts[j];
+            trx.actions.emplace_back( vector<permission_level>{ { config::system_account_name, config::active_name } },
+                                      newaccount{
+                                         .creator = config::system_account_name,
+                                         .name    = a,
+                                         .owner   = authority( get_public_key( a, "owner" ) ),
+                                         .active  = authority( get_public_key( a, "active" ) )
+                                      });
+            trx.actions.emplace_back( get_action( config::system_account_name, N(buyrambytes),
+                                                  vector<permission_level>{ { config::system_account_name, config::active_name } },
+                                                  mvo()("payer", "eosio")("receiver", a)("bytes", 8000) ) );
+            trx.actions.emplace_back( get_action( config::system_account_name, N(delegatebw),
+                                                  vector<permission_level>{ { config::system_account_name, config::active_name } },
+                                                  mvo()("from", "eosio")("receiver", a)
+                                                  ("stake_net_quantity", stake)("stake_cpu_quantity", stake)("transfer", 1) ) );
+         }
+         set_transaction_headers( trx );
+         trx.sign( get_private_key( config::system_account_name, "active" ), control->get_chain_id() );
+         push_transaction( trx );
+         produce_block();
+      }
+   }
+
+   /**
+    * Pushes one action per account in batches, each signed by the active key of its account
+    */
+   template<typename Data>
+   void push_batched( const std::vector<account_name>& accounts, const action_name& act, Data&& data, size_t batch = 20 ) {
+      for( size_t i = 0; i < accounts.size(); i += batch ) {
+         signed_transaction trx;
+         set_transaction_headers( trx );
+         for( size_t j = i; j < std::min( accounts.size(), i + batch ); ++j ) {
+            trx.actions.emplace_back( get_action( config::system_account_name, act,
+                                                  vector<permission_level>{ { accounts[j], config::active_name } }, data( j ) ) );
+         }
+         set_transaction_headers( trx );
+         for( size_t j = i; j < std::min( accounts.size(), i + batch ); ++j ) {
+            trx.sign( get_private_key( accounts[j], "active" ), control->get_chain_id() );
+         }
+         push_transaction( trx );
+         produce_block();
+      }
+   }
+
+   /**
+    * Produces a block 'skip_time' after the head block and records the cost of its onblock. The onblock transaction
+    * is implicit and not billed, so its time is recorded as elapsed_us and cpu_usage_us stays 0.
+    */
+   void measure_onblock( const std::string& scenario, fc::microseconds skip_time = fc::milliseconds(config::block_interval_ms) ) {
+      transaction_trace_ptr onblock_trace;
+      boost::signals2::scoped_connection conn = control->applied_transaction.connect( [&]( const transaction_trace_ptr& t ) {
+         if( !t->action_traces.empty() && t->action_traces[0].act.name == N(onblock) ) {
+            onblock_trace = t;
+         }
+      });
+      produce_block( skip_time );
+      BOOST_REQUIRE( bool(onblock_trace) );
+
+      action_cost cost;
+      cost.scenario     = scenario;
+      cost.action       = "eosio::onblock";
+      cost.elapsed_us   = onblock_trace->elapsed.count();
+      for( const auto& at : onblock_trace->action_traces ) {
+         cost.ram_delta      += ram_delta( at );
+         cost.inline_actions += inline_actions( at );
+         add_profile( cost, at );
+      }
+      sort_functions( cost );
+      costs.push_back( cost );
+   }
+
+   static int64_t ram_delta( const action_trace& at ) {
+      int64_t delta = 0;
+      for( const auto& d : at.account_ram_deltas ) {
+         delta += d.delta;
+      }
+      for( const auto& inline_trace : at.inline_traces ) {
+         delta += ram_delta( inline_trace );
+      }
+      return delta;
+   }
+
+   static uint32_t inline_actions( const action_trace& at ) {
+      uint32_t count = at.inline_traces.size();
+      for( const auto& inline_trace : at.inline_traces ) {
+         count += inline_actions( inline_trace );
+      }
+      return count;
+   }
+
+   void write_report( const std::string& path )const {
+      fc::json::save_to_file( costs, path, true );
+   }
+
+   /**
+    * Writes the database intrinsic calls of the profiled contracts as a json object keyed by contract and
+    * action, each holding the calls of every recorded scenario of the action
+    */
+   void write_intrinsics_report( const std::string& path )const {
+      std::map<std::string, std::map<std::string, fc::variants>> grouped;
+      for( const auto& cost : costs ) {
+         const auto separator = cost.action.find( "::" );
+         grouped[cost.action.substr( 0, separator )][cost.action.substr( separator + 2 )].push_back( mvo()
+            ("scenario",   cost.scenario)
+            ("intrinsics", cost.intrinsics) );
+      }
+      mutable_variant_object report;
+      for( const auto& contract : grouped ) {
+         mutable_variant_object actions;
+         for( const auto& action : contract.second ) {
+            actions( action.first, action.second );
+         }
+         report( contract.first, actions );
+      }
+      fc::json::save_to_file( report, path, true );
+   }
+
+   /**
+    * Walks the tables of 'contracts' in the chain state and returns the footprint of each table, largest first
+    */
+   std::vector<table_footprint> table_footprints( const std::vector<account_name>& contracts )const {
+      const auto& db = control->db();
+      const auto& tables = db.get_index<table_id_multi_index, by_code_scope_table>();
+      const auto& rows = db.get_index<key_value_index, by_scope_primary>();
+
+      std::vector<table_footprint> result;
+      for( const auto& code : contracts ) {
+         std::map<uint64_t, table_footprint> footprints;
+         for( auto t = tables.lower_bound( boost::make_tuple( code ) ); t != tables.end() && t->code == code; ++t ) {
+            // secondary indices are stored as tables named after the primary one with the index number in the lowest 4 bits
+            const uint64_t primary_table = t->table.value & 0xFFFFFFFFFFFFFFF0ULL;
+            auto& f = footprints[primary_table];
+            if( primary_table != t->table.value ) {
+               f.secondary_rows += t->count;
+               f.billed_bytes   += secondary_billed_bytes<index64_index>( t->id ) + secondary_billed_bytes<index128_index>( t->id )
+                                 + secondary_billed_bytes<index256_index>( t->id ) + secondary_billed_bytes<index_double_index>( t->id )
+                                 + secondary_billed_bytes<index_long_double_index>( t->id );
+            } else {
+               ++f.scopes;
+               for( auto r = rows.lower_bound( boost::make_tuple( t->id ) ); r != rows.end() && r->t_id == t->id; ++r ) {
+                  ++f.rows;
+                  f.data_bytes   += r->value.size();
+                  f.billed_bytes += r->value.size() + config::billable_size_v<key_value_object>;
+               }
+            }
+            f.billed_bytes += config::billable_size_v<table_id_object>;
+         }
+         for( auto& entry : footprints ) {
+            auto& f = entry.second;
+            f.contract = code.to_string();
+            f.table    = name( entry.first ).to_string();
+            f.average_row_bytes = f.rows ? double(f.data_bytes) / f.rows : 0;
+            result.push_back( f );
+         }
+      }
+      std::sort( result.begin(), result.end(), []( const table_footprint& a, const table_footprint& b ) {
+         return a.billed_bytes > b.billed_bytes;
+      });
+      return result;
+   }
+
+   template<typename Index>
+   uint64_t secondary_billed_bytes( const table_id& t_id )const {
+      const auto& entries = control->db().get_index<Index, by_primary>();
+      uint64_t bytes = 0;
+      for( auto e = entries.lower_bound( boost::make_tuple( t_id ) ); e != entries.end() && e->t_id == t_id; ++e ) {
+         bytes += config::billable_size_v<typename Index::value_type>;
+      }
+      return bytes;
+   }
+
+   /**
+    * Returns a description of every recorded cost above the budget of its action. Budgets are read from a
+    * json object keyed by "<contract>::<action>"; actions without a budget and keys starting with '_' are not checked.
+    */
+   std::vector<std::string> check_budgets( const std::string& path )const {
+      std::map<std::string, action_budget> budgets;
+      for( const auto& entry : fc::json::from_file( path ).get_object() ) {
+         if( entry.key().empty() || entry.key()[0] == '_' ) continue;
+         budgets[entry.key()] = entry.value().as<action_budget>();
+      }
+
+      std::vector<std::string> exceeded;
+      for( const auto& cost : costs ) {
+         auto itr = budgets.find( cost.action );
+         if( itr == budgets.end() ) continue;
+
+         const auto& budget = itr->second;
+         if( budget.cpu_usage_us && cost.cpu_usage_us > *budget.cpu_usage_us )
+            exceeded.push_back( cost.action + " (" + cost.scenario + "): cpu " + std::to_string(cost.cpu_usage_us) + " us > " + std::to_string(*budget.cpu_usage_us) + " us" );
+         if( budget.net_usage && cost.net_usage > *budget.net_usage )
+            exceeded.push_back( cost.action + " (" + cost.scenario + "): net " + std::to_string(cost.net_usage) + " bytes > " + std::to_string(*budget.net_usage) + " bytes" );
+         if( budget.ram_delta && cost.ram_delta > *budget.ram_delta )
+            exceeded.push_back( cost.action + " (" + cost.scenario + "): ram " + std::to_string(cost.ram_delta) + " bytes > " + std::to_string(*budget.ram_delta) + " bytes" );
+      }
+      return exceeded;
+   }
+
+   /**
+    * Writes a budget file derived from the recorded costs: the largest cost of each action over its scenarios,
+    * raised by 'cpu_margin_percent' for the cpu, which varies between runs, and by 'size_margin_percent' for
+    * the net and ram. Actions which free ram get a ram limit below zero. The margins are kept in the "_margins"
+    * entry.
+    */
+   void write_budgets( const std::string& path, uint32_t cpu_margin_percent, uint32_t size_margin_percent )const {
+      std::map<std::string, action_cost> largest;
+      for( const auto& cost : costs ) {
+         auto itr = largest.find( cost.action );
+         if( itr == largest.end() ) {
+            largest.emplace( cost.action, cost );
+            continue;
+         }
+         auto& l = itr->second;
+         l.cpu_usage_us = std::max( l.cpu_usage_us, cost.cpu_usage_us );
+         l.net_usage    = std::max( l.net_usage, cost.net_usage );
+         l.ram_delta    = std::max( l.ram_delta, cost.ram_delta );
+      }
+      auto raise = []( int64_t value, uint32_t margin_percent ) {
+         return value + ( std::abs( value ) * margin_percent + 99 ) / 100;
+      };
+
+      mutable_variant_object budgets;
+      budgets( "_margins", mvo()("cpu_percent", cpu_margin_percent)("size_percent", size_margin_percent) );
+      for( const auto& l : largest ) {
+         action_budget budget;
+         budget.cpu_usage_us = static_cast<uint32_t>( raise( l.second.cpu_usage_us, cpu_margin_percent ) );
+         budget.net_usage    = static_cast<uint64_t>( raise( l.second.net_usage, size_margin_percent ) );
+         budget.ram_delta    = raise( l.second.ram_delta, size_margin_percent );
+         budgets( l.first, budget );
+      }
+      fc::json::save_to_file( budgets, path, true );
+   }
+
+   std::vector<action_cost> costs;
+   std::map<account_name, std::vector<wasm_profiler::counter>> profiled_contracts;
+};
+
+} /// eosio_system
@@ -0,0 +1,232 @@
+#include <boost/test/unit_test.hpp>
+#include <eosio/chain/contract_table_objects.hpp>
+#include <eosio/chain/global_property_object.hpp>
+#include <eosio/chain/resource_limits.hpp>
+#include <eosio/chain/wast_to_wasm.hpp>
+#include <cstdlib>
+#include <iostream>
+#include <fc/log/logger.hpp>
+#include <eosio/chain/exceptions.hpp>
+#include <Runtime/Runtime.h>
+
+#include "eosio.benchmark_tester.hpp"
+
+using namespace eosio_system;
+
+namespace {
+
+/**
+ * Runs the actions of eosio.token, eosio.system and eosio.msig in representative scenarios, profiling
+ * eosio.msig once it is deployed when 'profile' is set
+ */
+void run_actions( eosio_benchmark_tester& t, bool profile ) {
+   const asset core_symbol_zero = core_sym::from_string("0.0000");
+
+   // eosio.token
+   t.measure( "new balance row", N(eosio.token), N(transfer), config::system_account_name, mvo()
+              ("from", "eosio")("to", "alice1111111")("quantity", core_sym::from_string("1000.0000"))("memo", "") );
+   t.measure( "existing balance row", N(eosio.token), N(transfer), config::system_account_name, mvo()
+              ("from", "eosio")("to", "alice1111111")("quantity", core_sym::from_string("1000.0000"))("memo", "") );
+   t.measure( "own balance row", N(eosio.token), N(open), N(bob111111111), mvo()
+              ("owner", "bob111111111")("symbol", core_symbol_zero.get_symbol())("ram_payer", "bob111111111") );
+   t.measure( "empty balance row", N(eosio.token), N(close), N(bob111111111), mvo()
+              ("owner", "bob111111111")("symbol", core_symbol_zero.get_symbol()) );
+
+   // eosio.system
+   t.measure( "tokens", config::system_account_name, N(buyram), N(alice1111111), mvo()
+              ("payer", "alice1111111")("receiver", "alice1111111")("quant", core_sym::from_string("10.0000")) );
+   t.measure( "bytes", config::system_account_name, N(buyrambytes), N(alice1111111), mvo()
+              ("payer", "alice1111111")("receiver", "alice1111111")("bytes", 1024) );
+   t.measure( "bytes", config::system_account_name, N(sellram), N(alice1111111), mvo()
+              ("account", "alice1111111")("bytes", 1024) );
+   t.measure( "fees of previous trades", config::system_account_name, N(settleramfee), N(bob111111111), mvo() );
+   t.measure( "new delegation", config::system_account_name, N(delegatebw), N(alice1111111), mvo()
+              ("from", "alice1111111")("receiver", "bob111111111")
+              ("stake_net_quantity", core_sym::from_string("10.0000"))("stake_cpu_quantity", core_sym::from_string("10.0000"))
+              ("transfer", 0) );
+   t.measure( "existing delegation", config::system_account_name, N(delegatebw), N(alice1111111), mvo()
+              ("from", "alice1111111")("receiver", "bob111111111")
+              ("stake_net_quantity", core_sym::from_string("10.0000"))("stake_cpu_quantity", core_sym::from_string("10.0000"))
+              ("transfer", 0) );
+   t.measure( "partial", config::system_account_name, N(undelegatebw), N(alice1111111), mvo()
+              ("from", "alice1111111")("receiver", "bob111111111")
+              ("unstake_net_quantity", core_sym::from_string("5.0000"))("unstake_cpu_quantity", core_sym::from_string("5.0000")) );
+   t.produce_block( fc::days(3) );
+   t.measure( "after delay", config::system_account_name, N(refund), N(alice1111111), mvo()("owner", "alice1111111") );
+   t.measure( "new producer", config::system_account_name, N(regproducer), N(alice1111111), mvo()
+              ("producer", "alice1111111")("producer_key", t.get_public_key( N(alice1111111), "active" ))
+              ("url", "https://alice.example")("location", 0) );
+   t.measure( "one producer", config::system_account_name, N(voteproducer), N(alice1111111), mvo()
+              ("voter", "alice1111111")("proxy", name(0))("producers", vector<account_name>{ N(alice1111111) }) );
+   t.measure( "new proxy", config::system_account_name, N(regproxy), N(carol1111111), mvo()
+              ("proxy", "carol1111111")("isproxy", true) );
+   t.measure( "first bid", config::system_account_name, N(bidname), N(alice1111111), mvo()
+              ("bidder", "alice1111111")("newname", "prefa")("bid", core_sym::from_string("1.0000")) );
+
+   // eosio.msig
+   t.create_account_with_resources( N(eosio.msig), config::system_account_name, 1024 * 1024 );
+   t.base_tester::push_action( config::system_account_name, N(setpriv), config::system_account_name, mvo()
+                               ("account", "eosio.msig")("is_priv", 1) );
+   t.set_code( N(eosio.msig), contracts::msig_wasm() );
+   t.set_abi( N(eosio.msig), contracts::msig_abi().data() );
+   t.produce_blocks();
+   if( profile ) {
+      t.profile_contract( N(eosio.msig) );
+   }
+
+   variant pretty_trx = mvo()
+      ("expiration", fc::time_point_sec( t.control->head_block_time() + fc::hours(1) ))
+      ("ref_block_num", 2)
+      ("ref_block_prefix", 3)
+      ("max_net_usage_words", 0)
+      ("max_cpu_usage_ms", 0)
+      ("delay_sec", 0)
+      ("actions", fc::variants({
+            mvo()
+               ("account", "eosio.token")
+               ("name", "transfer")
+               ("authorization", vector<permission_level>{ { N(alice1111111), config::active_name } })
+               ("data", mvo()("from", "alice1111111")("to", "bob111111111")("quantity", core_sym::from_string("1.0000"))("memo", ""))
+            })
+      );
+   transaction trx;
+   abi_serializer::from_variant( pretty_trx, trx, t.get_resolver(), eosio_system_tester::abi_serializer_max_time );
+
+   for( auto proposal_name : { N(first), N(second) } ) {
+      t.measure( "one action", N(eosio.msig), N(propose), N(alice1111111), mvo()
+               ("proposer", "alice1111111")("proposal_name", proposal_name)("trx", trx)
+               ("requested", vector<permission_level>{ { N(alice1111111), config::active_name } }) );
+   }
+   t.measure( "one approval", N(eosio.msig), N(approve), N(alice1111111), mvo()
+              ("proposer", "alice1111111")("proposal_name", "first")
+              ("level", permission_level{ N(alice1111111), config::active_name }) );
+   t.measure( "one action", N(eosio.msig), N(exec), N(bob111111111), mvo()
+              ("proposer", "alice1111111")("proposal_name", "first")("executer", "bob111111111") );
+   t.measure( "not approved", N(eosio.msig), N(cancel), N(alice1111111), mvo()
+              ("proposer", "alice1111111")("proposal_name", "second")("canceler", "alice1111111") );
+}
+
+} /// namespace
+
+BOOST_AUTO_TEST_SUITE(eosio_benchmark_tests)
+
+// Runs the actions of eosio.token, eosio.system and eosio.msig in representative scenarios and checks what
+// each is billed against benchmark_budgets.json, or the file in BENCHMARK_BUDGETS. The costs are written to
+// the file in BENCHMARK_REPORT when it is set. When BENCHMARK_WRITE_BUDGETS is set, budgets derived from this
+// run with BENCHMARK_CPU_MARGIN percent more cpu and BENCHMARK_SIZE_MARGIN percent more net and ram are
+// written to that file instead of being checked.
+BOOST_FIXTURE_TEST_CASE( action_costs, eosio_benchmark_tester ) try {
+   run_actions( *this, false );
+
+   for( const auto& cost : costs ) {
+      BOOST_TEST_MESSAGE( cost.action << " (" << cost.scenario << "): " << cost.cpu_usage_us << " us, "
+                          << cost.net_usage << " net bytes, " << cost.ram_delta << " ram bytes" );
+   }
+
+   if( const char* report = std::getenv( "BENCHMARK_REPORT" ) ) {
+      write_report( report );
+   }
+
+   if( const char* path = std::getenv( "BENCHMARK_WRITE_BUDGETS" ) ) {
+      write_budgets( path, env_uint( "BENCHMARK_CPU_MARGIN", 50 ), env_uint( "BENCHMARK_SIZE_MARGIN", 10 ) );
+      return;
+   }
+
+   const char* budgets = std::getenv( "BENCHMARK_BUDGETS" );
+   for( const auto& exceeded : check_budgets( budgets ? budgets : contracts::util::benchmark_budgets() ) ) {
+      BOOST_ERROR( "over budget: " << exceeded );
+   }
+} FC_LOG_AND_RETHROW()
+
+// Runs the same actions with instrumented eosio.token, eosio.system and eosio.msig contracts on two chains and
+// reports the wasm instructions and database intrinsic calls of each action, and in which functions the
+// instructions are spent. The counts do not depend on the speed of the machine, so they must be identical on
+// both chains. They are written to the file in PROFILE_REPORT when it is set, and the intrinsic calls grouped
+// by contract and action to the file in INTRINSICS_REPORT.
+BOOST_AUTO_TEST_CASE( action_instructions ) try {
+   std::vector<eosio_benchmark_tester> chains( 2 );
+   for( auto& t : chains ) {
+      t.profile_contract( N(eosio.token) );
+      t.profile_contract( config::system_account_name );
+      run_actions( t, true );
+   }
+
+   const auto& costs = chains.front().costs;
+   BOOST_REQUIRE_EQUAL( costs.size(), chains.back().costs.size() );
+   for( size_t i = 0; i < costs.size(); ++i ) {
+      const auto& cost  = costs[i];
+      const auto& again = chains.back().costs[i];
+      BOOST_TEST( cost.instructions > 0u );
+      BOOST_TEST( cost.instructions == again.instructions );
+      BOOST_REQUIRE_EQUAL( cost.intrinsics.size(), again.intrinsics.size() );
+      for( size_t j = 0; j < cost.intrinsics.size(); ++j ) {
+         BOOST_TEST( cost.intrinsics[j].calls == again.intrinsics[j].calls );
+         BOOST_TEST( cost.intrinsics[j].bytes == again.intrinsics[j].bytes );
+      }
+
+      BOOST_TEST_MESSAGE( cost.action << " (" << cost.scenario << "): " << cost.instructions << " instructions" );
+      for( size_t f = 0; f < std::min<size_t>( 5, cost.functions.size() ); ++f ) {
+         BOOST_TEST_MESSAGE( "   " << cost.functions[f].contract << " " << cost.functions[f].function << ": "
+                             << cost.functions[f].instructions );
+      }
+      for( const auto& intrinsic : cost.intrinsics ) {
+         BOOST_TEST_MESSAGE( "   " << intrinsic.contract << " " << intrinsic.intrinsic << ": " << intrinsic.calls << " calls"
+                             << ( intrinsic.bytes ? ", " + std::to_string( intrinsic.bytes ) + " bytes" : std::string() ) );
+      }
+   }
+
+   // a transfer between existing balances modifies the row of each account
+   const auto transfer = std::find_if( costs.begin(), costs.end(), []( const action_cost& c ) {
+      return c.action == "eosio.token::transfer" && c.scenario == "existing balance row";
+   });
+   BOOST_REQUIRE( transfer != costs.end() );
+   const auto updates = std::find_if( transfer->intrinsics.begin(), transfer->intrinsics.end(), []( const intrinsic_cost& i ) {
+      return i.contract == "eosio.token" && i.intrinsic == "db_update_i64";
+   });
+   BOOST_REQUIRE( updates != transfer->intrinsics.end() );
+   BOOST_TEST( updates->calls == 2u );
+
+   if( const char* report = std::getenv( "PROFILE_REPORT" ) ) {
+      fc::json::save_to_file( costs, report, true );
+   }
+   if( const char* report = std::getenv( "INTRINSICS_REPORT" ) ) {
+      chains.front().write_intrinsics_report( report );
+   }
+} FC_LOG_AND_RETHROW()
+
+// Walks the tables of eosio, eosio.token and eosio.msig after the benchmark actions and reports the rows and
+// ram of each. The footprints are written to the file in FOOTPRINT_REPORT when it is set.
+BOOST_FIXTURE_TEST_CASE( table_footprints, eosio_benchmark_tester ) try {
+   run_actions( *this, false );
+
+   const auto footprints = table_footprints( { config::system_account_name, N(eosio.token), N(eosio.msig) } );
+   for( const auto& f : footprints ) {
+      BOOST_TEST_MESSAGE( f.contract << " " << f.table << ": " << f.rows << " rows in " << f.scopes << " scopes, "
+                          << f.data_bytes << " data bytes, " << f.billed_bytes << " billed bytes, "
+                          << f.average_row_bytes << " bytes per row" );
+   }
+
+   auto find = [&]( const std::string& contract, const std::string& table ) {
+      auto itr = std::find_if( footprints.begin(), footprints.end(), [&]( const table_footprint& f ) {
+         return f.contract == contract && f.table == table;
+      });
+      BOOST_REQUIRE( itr != footprints.end() );
+      return *itr;
+   };
+   // one balance for each account which received tokens, in its own scope
+   const auto accounts = find( "eosio.token", "accounts" );
+   BOOST_TEST( accounts.rows == accounts.scopes );
+   // voters is indexed by owner only, producers also by total votes
+   BOOST_TEST( find( "eosio", "voters" ).secondary_rows == 0u );
+   const auto producers = find( "eosio", "producers" );
+   BOOST_TEST( producers.secondary_rows == producers.rows );
+   for( const auto& f : footprints ) {
+      BOOST_TEST( f.billed_bytes > f.data_bytes );
+   }
+
+   if( const char* report = std::getenv( "FOOTPRINT_REPORT" ) ) {
+      fc::json::save_to_file( footprints, report, true );
+   }
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,163 @@
+#include <boost/test/unit_test.hpp>
+#include <eosio/testing/tester.hpp>
+#include <eosio/chain/abi_serializer.hpp>
+#include <eosio/chain/resource_limits.hpp>
+
+#include <Runtime/Runtime.h>
+
+#include <fc/variant_object.hpp>
+
+#include "contracts.hpp"
+
+using namespace eosio::testing;
+using namespace eosio;
+using namespace eosio::chain;
+using namespace eosio::testing;
+using namespace fc;
+
+using mvo = fc::mutable_variant_object;
+
+class eosio_bios_tester : public tester {
+public:
+
+   eosio_bios_tester() {
+      set_code( config::system_account_name, contracts::bios_wasm() );
+      set_abi( config::system_account_name, contracts::bios_abi().data() );
+      produce_blocks();
+
+      const auto& accnt = control->db().get<account_object,by_name>( config::system_account_name );
+      abi_def abi;
+      BOOST_REQUIRE_EQUAL(abi_serializer::to_abi(accnt.abi, abi), true);
+      abi_ser.set_abi(abi, abi_serializer_max_time);
+   }
+
+   action_result push_action( const account_name& signer, const action_name &name, const variant_object &data ) {
+      string action_type_name = abi_ser.get_action_type(name);
+
+      action act;
+      act.account = config::system_account_name;
+      act.name    = name;
+      act.data    = abi_ser.variant_to_binary( action_type_name, data,abi_serializer_max_time );
+
+      return base_tester::push_action( std::move(act), uint64_t(signer));
+   }
+
+   vector<account_name> make_accounts( const string& prefix, uint32_t count ) {
+      vector<account_name> accounts;
+      accounts.reserve( count );
+      for( uint32_t i = 0; i < count; ++i ) {
+         string n = prefix;
+         for( uint32_t v = i, d = 0; d < 3; ++d, v /= 26 ) {
+            n += char('a' + v % 26);
+         }
+         accounts.emplace_back( n );
+      }
+      for( size_t i = 0; i < accounts.size(); i += 50 ) {
+         create_accounts( vector<account_name>( accounts.begin() + i, accounts.begin() + std::min( accounts.size(), i + 50 ) ) );
+         produce_block();
+      }
+      return accounts;
+   }
+
+   void check_configured( const vector<account_name>& accounts, int64_t ram_bytes, int64_t net_weight, int64_t cpu_weight ) {
+      for( const auto& a : accounts ) {
+         BOOST_REQUIRE( control->db().get<account_object,by_name>( a ).privileged );
+         int64_t ram = 0, net = 0, cpu = 0;
+         control->get_resource_limits_manager().get_account_limits( a, ram, net, cpu );
+         BOOST_REQUIRE_EQUAL( ram_bytes, ram );
+         BOOST_REQUIRE_EQUAL( net_weight, net );
+         BOOST_REQUIRE_EQUAL( cpu_weight, cpu );
+      }
+   }
+
+   abi_serializer abi_ser;
+};
+
+BOOST_AUTO_TEST_SUITE(eosio_bios_tests)
+
+BOOST_FIXTURE_TEST_CASE( bootstrap, eosio_bios_tester ) try {
+   auto accounts = make_accounts( "boot", 3 );
+   auto abi_hash = fc::sha256::hash( string("abi") );
+
+   BOOST_REQUIRE_EQUAL( success(), push_action( config::system_account_name, N(bootstrap), mvo()
+                                                ("privs", fc::variants({
+                                                      mvo()("account", accounts[0])("is_priv", 1),
+                                                      mvo()("account", accounts[1])("is_priv", 1),
+                                                      mvo()("account", accounts[2])("is_priv", 1)
+                                                   }))
+                                                ("limits", fc::variants({
+                                                      mvo()("account", accounts[0])("ram_bytes", 100000)("net_weight", 10)("cpu_weight", 20),
+                                                      mvo()("account", accounts[1])("ram_bytes", 100000)("net_weight", 10)("cpu_weight", 20),
+                                                      mvo()("account", accounts[2])("ram_bytes", 100000)("net_weight", 10)("cpu_weight", 20)
+                                                   }))
+                                                ("abi_hashes", fc::variants({
+                                                      mvo()("owner", accounts[0])("hash", abi_hash)
+                                                   }))
+                       )
+   );
+   produce_block();
+
+   check_configured( accounts, 100000, 10, 20 );
+   auto row = abi_ser.binary_to_variant( "abi_hash", get_row_by_account( config::system_account_name, config::system_account_name,
+                                                                         N(abihash), accounts[0] ), abi_serializer_max_time );
+   BOOST_REQUIRE_EQUAL( abi_hash, row["hash"].as<fc::sha256>() );
+
+   // only eosio can bootstrap
+   BOOST_REQUIRE_EQUAL( error("missing authority of eosio"),
+                        push_action( accounts[0], N(bootstrap), mvo()
+                                     ("privs", fc::variants())
+                                     ("limits", fc::variants())
+                                     ("abi_hashes", fc::variants())
+                        )
+   );
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( bootstrap_vs_individual_actions, eosio_bios_tester ) try {
+   const uint32_t count = 200;
+   const int64_t ram_bytes = 100000, net_weight = 10, cpu_weight = 20;
+
+   // one transaction per setpriv and setalimits
+   auto individual = make_accounts( "indv", count );
+   auto start = fc::time_point::now();
+   for( size_t i = 0; i < individual.size(); ++i ) {
+      base_tester::push_action( config::system_account_name, N(setpriv), config::system_account_name, mvo()
+                                ("account", individual[i])
+                                ("is_priv", 1)
+      );
+      base_tester::push_action( config::system_account_name, N(setalimits), config::system_account_name, mvo()
+                                ("account",    individual[i])
+                                ("ram_bytes",  ram_bytes)
+                                ("net_weight", net_weight)
+                                ("cpu_weight", cpu_weight)
+      );
+      if( i % 50 == 49 ) {
+         produce_block();
+      }
+   }
+   produce_block();
+   auto individual_time = fc::time_point::now() - start;
+   check_configured( individual, ram_bytes, net_weight, cpu_weight );
+
+   // a single bootstrap action
+   auto batch = make_accounts( "btch", count );
+   fc::variants privs, limits;
+   for( const auto& a : batch ) {
+      privs.push_back( mvo()("account", a)("is_priv", 1) );
+      limits.push_back( mvo()("account", a)("ram_bytes", ram_bytes)("net_weight", net_weight)("cpu_weight", cpu_weight) );
+   }
+   start = fc::time_point::now();
+   BOOST_REQUIRE_EQUAL( success(), push_action( config::system_account_name, N(bootstrap), mvo()
+                                                ("privs",      privs)
+                                                ("limits",     limits)
+                                                ("abi_hashes", fc::variants())
+                       )
+   );
+   produce_block();
+   auto batch_time = fc::time_point::now() - start;
+   check_configured( batch, ram_bytes, net_weight, cpu_weight );
+
+   BOOST_TEST_MESSAGE( "configuring " << count << " accounts: individual actions = " << individual_time.count() / 1000 << " ms, "
+                       << "bootstrap = " << batch_time.count() / 1000 << " ms" );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,160 @@
+#include <boost/test/unit_test.hpp>
+#include <eosio/chain/contract_table_objects.hpp>
+#include <eosio/chain/global_property_object.hpp>
+#include <eosio/chain/resource_limits.hpp>
+#include <eosio/chain/wast_to_wasm.hpp>
+#include <cstdlib>
+#include <iostream>
+#include <fc/log/logger.hpp>
+#include <eosio/chain/exceptions.hpp>
+#include <Runtime/Runtime.h>
+
+#include "eosio.benchmark_tester.hpp"
+
+using namespace eosio_system;
+
+namespace {
+
+// Core symbol compiled into contracts::util::system_wasm_old(), both chains use it so that the actions are identical
+const symbol old_contract_core_symbol{ ::eosio::chain::string_to_symbol_c( 4, "SYS" ) };
+
+asset sys( const std::string& s ) {
+   return asset::from_string( s + " SYS" );
+}
+
+/**
+ * Deploys either the bundled old or the current system and msig contracts and creates the accounts used by run_actions
+ */
+void setup_chain( eosio_benchmark_tester& t, bool old_contracts ) {
+   t.create_currency( N(eosio.token), config::system_account_name, asset( 100000000000000, old_contract_core_symbol ) );
+   t.issue( config::system_account_name, asset( 10000000000000, old_contract_core_symbol ) );
+
+   if( old_contracts ) {
+      t.set_code( config::system_account_name, contracts::util::system_wasm_old() );
+      t.set_abi( config::system_account_name, contracts::util::system_abi_old().data() );
+   } else {
+      t.deploy_contract( false );
+      t.base_tester::push_action( config::system_account_name, N(init), config::system_account_name, mvo()
+                                  ("version", 0)
+                                  ("core", "4,SYS") );
+   }
+   t.produce_blocks();
+
+   for( auto a : { N(alice1111111), N(bob111111111), N(carol1111111) } ) {
+      t.create_account_with_resources( a, config::system_account_name, sys("10.0000"), false, sys("10.0000"), sys("10.0000") );
+      t.transfer( config::system_account_name, a, sys("1000.0000"), config::system_account_name );
+   }
+
+   t.create_account_with_resources( N(eosio.msig), config::system_account_name, 1024 * 1024 );
+   t.base_tester::push_action( config::system_account_name, N(setpriv), config::system_account_name, mvo()
+                               ("account", "eosio.msig")("is_priv", 1) );
+   t.set_code( N(eosio.msig), old_contracts ? contracts::util::msig_wasm_old() : contracts::msig_wasm() );
+   t.set_abi( N(eosio.msig), old_contracts ? contracts::util::msig_abi_old().data() : contracts::msig_abi().data() );
+   t.produce_blocks();
+}
+
+/**
+ * Runs the same sequence of actions, which only uses actions present in both the old and the current contracts
+ */
+void run_actions( eosio_benchmark_tester& t ) {
+   t.measure( "existing balance row", N(eosio.token), N(transfer), N(alice1111111), mvo()
+              ("from", "alice1111111")("to", "bob111111111")("quantity", sys("10.0000"))("memo", "") );
+   t.measure( "tokens", config::system_account_name, N(buyram), N(alice1111111), mvo()
+              ("payer", "alice1111111")("receiver", "alice1111111")("quant", sys("10.0000")) );
+   t.measure( "bytes", config::system_account_name, N(buyrambytes), N(alice1111111), mvo()
+              ("payer", "alice1111111")("receiver", "alice1111111")("bytes", 1024) );
+   t.measure( "bytes", config::system_account_name, N(sellram), N(alice1111111), mvo()
+              ("account", "alice1111111")("bytes", 1024) );
+   t.measure( "new delegation", config::system_account_name, N(delegatebw), N(alice1111111), mvo()
+              ("from", "alice1111111")("receiver", "bob111111111")
+              ("stake_net_quantity", sys("10.0000"))("stake_cpu_quantity", sys("10.0000"))("transfer", 0) );
+   t.measure( "partial", config::system_account_name, N(undelegatebw), N(alice1111111), mvo()
+              ("from", "alice1111111")("receiver", "bob111111111")
+              ("unstake_net_quantity", sys("5.0000"))("unstake_cpu_quantity", sys("5.0000")) );
+   t.produce_block( fc::days(3) );
+   t.measure( "after delay", config::system_account_name, N(refund), N(alice1111111), mvo()("owner", "alice1111111") );
+   t.measure( "new producer", config::system_account_name, N(regproducer), N(alice1111111), mvo()
+              ("producer", "alice1111111")("producer_key", t.get_public_key( N(alice1111111), "active" ))
+              ("url", "https://alice.example")("location", 0) );
+   t.measure( "one producer", config::system_account_name, N(voteproducer), N(alice1111111), mvo()
+              ("voter", "alice1111111")("proxy", name(0))("producers", vector<account_name>{ N(alice1111111) }) );
+   t.measure( "new proxy", config::system_account_name, N(regproxy), N(carol1111111), mvo()
+              ("proxy", "carol1111111")("isproxy", true) );
+   t.measure( "first bid", config::system_account_name, N(bidname), N(alice1111111), mvo()
+              ("bidder", "alice1111111")("newname", "prefa")("bid", sys("1.0000")) );
+
+   variant pretty_trx = mvo()
+      ("expiration", fc::time_point_sec( t.control->head_block_time() + fc::hours(1) ))
+      ("ref_block_num", 2)
+      ("ref_block_prefix", 3)
+      ("max_net_usage_words", 0)
+      ("max_cpu_usage_ms", 0)
+      ("delay_sec", 0)
+      ("actions", fc::variants({
+            mvo()
+               ("account", "eosio.token")
+               ("name", "transfer")
+               ("authorization", vector<permission_level>{ { N(alice1111111), config::active_name } })
+               ("data", mvo()("from", "alice1111111")("to", "bob111111111")("quantity", sys("1.0000"))("memo", ""))
+            })
+      );
+   transaction trx;
+   abi_serializer::from_variant( pretty_trx, trx, t.get_resolver(), eosio_system_tester::abi_serializer_max_time );
+
+   for( auto proposal_name : { N(first), N(second) } ) {
+      t.measure( "one action", N(eosio.msig), N(propose), N(alice1111111), mvo()
+                 ("proposer", "alice1111111")("proposal_name", proposal_name)("trx", trx)
+                 ("requested", vector<permission_level>{ { N(alice1111111), config::active_name } }) );
+   }
+   t.measure( "one approval", N(eosio.msig), N(approve), N(alice1111111), mvo()
+              ("proposer", "alice1111111")("proposal_name", "first")
+              ("level", permission_level{ N(alice1111111), config::active_name }) );
+   t.measure( "one action", N(eosio.msig), N(exec), N(bob111111111), mvo()
+              ("proposer", "alice1111111")("proposal_name", "first")("executer", "bob111111111") );
+   t.measure( "not approved", N(eosio.msig), N(cancel), N(alice1111111), mvo()
+              ("proposer", "alice1111111")("proposal_name", "second")("canceler", "alice1111111") );
+}
+
+} /// namespace
+
+BOOST_AUTO_TEST_SUITE(eosio_differential_tests)
+
+// Runs identical actions against the bundled old and the current system and msig contracts and reports the
+// change in billed cpu, ram and inline actions of each. The comparison is written to the file in
+// DIFFERENTIAL_REPORT when it is set.
+BOOST_AUTO_TEST_CASE( old_vs_current_contracts ) try {
+   eosio_benchmark_tester old_chain( eosio_system_tester::setup_level::minimal );
+   setup_chain( old_chain, true );
+   run_actions( old_chain );
+
+   eosio_benchmark_tester new_chain( eosio_system_tester::setup_level::minimal );
+   setup_chain( new_chain, false );
+   run_actions( new_chain );
+
+   BOOST_REQUIRE_EQUAL( old_chain.costs.size(), new_chain.costs.size() );
+
+   fc::variants report;
+   for( size_t i = 0; i < old_chain.costs.size(); ++i ) {
+      const auto& o = old_chain.costs[i];
+      const auto& n = new_chain.costs[i];
+      BOOST_REQUIRE_EQUAL( o.action, n.action );
+
+      BOOST_TEST_MESSAGE( n.action << " (" << n.scenario << "): "
+                          << "cpu " << o.cpu_usage_us << " -> " << n.cpu_usage_us << " us ("
+                          << int64_t(n.cpu_usage_us) - int64_t(o.cpu_usage_us) << "), "
+                          << "ram " << o.ram_delta << " -> " << n.ram_delta << " bytes (" << n.ram_delta - o.ram_delta << "), "
+                          << "inline actions " << o.inline_actions << " -> " << n.inline_actions << " ("
+                          << int64_t(n.inline_actions) - int64_t(o.inline_actions) << ")" );
+      report.push_back( mvo()
+                        ("scenario", n.scenario)
+                        ("action",   n.action)
+                        ("old",      o)
+                        ("current",  n) );
+   }
+
+   if( const char* path = std::getenv( "DIFFERENTIAL_REPORT" ) ) {
+      fc::json::save_to_file( report, path, true );
+   }
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,175 @@
+#include <boost/test/unit_test.hpp>
+#include <eosio/chain/contract_table_objects.hpp>
+#include <eosio/chain/global_property_object.hpp>
+#include <eosio/chain/resource_limits.hpp>
+#include <eosio/chain/wast_to_wasm.hpp>
+#include <cstdlib>
+#include <iostream>
+#include <fc/log/logger.hpp>
+#include <eosio/chain/exceptions.hpp>
+#include <Runtime/Runtime.h>
+
+#include "eosio.benchmark_tester.hpp"
+
+#include <algorithm>
+
+using namespace eosio_system;
+
+namespace {
+
+/**
+ * Sizes of the voting population, read from the environment
+ */
+struct load_config {
+   uint32_t producers       = env_uint( "LOAD_PRODUCERS", 500 );
+   uint32_t voters          = env_uint( "LOAD_VOTERS", 100000 );
+   uint32_t proxies         = env_uint( "LOAD_PROXIES", 100 );
+   uint32_t proxied_percent = env_uint( "LOAD_PROXIED_PERCENT", 50 ); ///< share of the voters which vote through a proxy
+   uint32_t steps           = env_uint( "LOAD_STEPS", 5 );            ///< points of the scaling curve
+   uint32_t batch           = env_uint( "LOAD_BATCH", 20 );           ///< accounts created or voting per transaction
+};
+
+class eosio_load_tester : public eosio_benchmark_tester {
+public:
+   load_config cfg;
+
+   std::vector<account_name> producers;
+   std::vector<account_name> proxies;
+   std::vector<account_name> voters;
+
+   /// up to 30 producers starting at 'first', sorted as voteproducer requires
+   std::vector<account_name> producer_window( size_t first )const {
+      std::vector<account_name> window;
+      for( size_t i = 0; i < std::min<size_t>( 30, producers.size() ); ++i ) {
+         window.push_back( producers[( first + i ) % producers.size()] );
+      }
+      std::sort( window.begin(), window.end() );
+      return window;
+   }
+
+   void grow_producers( uint32_t count ) {
+      std::vector<account_name> added;
+      for( uint32_t i = producers.size(); i < count; ++i ) {
+         added.push_back( generated_account( "prod", i ) );
+      }
+      create_staked_accounts( added, core_sym::from_string("10.0000"), cfg.batch );
+      push_batched( added, N(regproducer), [&]( size_t j ) {
+         return mvo()("producer", added[j])("producer_key", get_public_key( added[j], "active" ))
+                     ("url", "https://" + added[j].to_string() + ".example")("location", 0);
+      }, cfg.batch );
+      producers.insert( producers.end(), added.begin(), added.end() );
+   }
+
+   void grow_proxies( uint32_t count ) {
+      std::vector<account_name> added;
+      for( uint32_t i = proxies.size(); i < count; ++i ) {
+         added.push_back( generated_account( "prxy", i ) );
+      }
+      create_staked_accounts( added, core_sym::from_string("10.0000"), cfg.batch );
+      push_batched( added, N(regproxy), [&]( size_t j ) { return mvo()("proxy", added[j])("isproxy", true); }, cfg.batch );
+      const size_t first = proxies.size();
+      push_batched( added, N(voteproducer), [&]( size_t j ) {
+         return mvo()("voter", added[j])("proxy", name(0))("producers", producer_window( first + j ));
+      }, cfg.batch );
+      proxies.insert( proxies.end(), added.begin(), added.end() );
+   }
+
+   void grow_voters( uint32_t count ) {
+      std::vector<account_name> added;
+      for( uint32_t i = voters.size(); i < count; ++i ) {
+         added.push_back( generated_account( "votr", i ) );
+      }
+      create_staked_accounts( added, core_sym::from_string("1.0000"), cfg.batch );
+      const size_t first = voters.size();
+      push_batched( added, N(voteproducer), [&]( size_t j ) {
+         const size_t index = first + j;
+         if( !proxies.empty() && index % 100 < cfg.proxied_percent ) {
+            return mvo()("voter", added[j])("proxy", proxies[index % proxies.size()])("producers", vector<account_name>());
+         }
+         return mvo()("voter", added[j])("proxy", name(0))("producers", producer_window( index ));
+      }, cfg.batch );
+      voters.insert( voters.end(), added.begin(), added.end() );
+   }
+
+   /// stakes and votes with more than 15% of the supply so that the producers are elected and paid
+   void activate() {
+      transfer( "eosio", "alice1111111", core_sym::from_string("300000000.0000"), "eosio" );
+      BOOST_REQUIRE_EQUAL( success(), stake( "alice1111111", "alice1111111", core_sym::from_string("100000000.0000"), core_sym::from_string("100000000.0000") ) );
+      BOOST_REQUIRE_EQUAL( success(), push_action( N(alice1111111), N(voteproducer), mvo()
+                                                   ("voter", "alice1111111")("proxy", name(0))("producers", producer_window( 0 )) ) );
+      produce_blocks( 250 );
+   }
+};
+
+} /// namespace
+
+BOOST_AUTO_TEST_SUITE(eosio_load_tests)
+
+// Grows the numbers of producers, proxies and voters to LOAD_PRODUCERS, LOAD_PROXIES and LOAD_VOTERS in
+// LOAD_STEPS steps and measures the voting and reward actions and the table footprints after each step. Only
+// runs when EOSIO_LOAD_TESTS is set; the costs are written to the file in BENCHMARK_REPORT and the footprints of
+// each step to the file in FOOTPRINT_REPORT when they are set.
+BOOST_FIXTURE_TEST_CASE( voting_scaling, eosio_load_tester,
+                         * boost::unit_test::precondition( env_is_set{ "EOSIO_LOAD_TESTS" } ) ) try {
+   BOOST_REQUIRE( cfg.producers >= 21 && cfg.voters > 0 && cfg.proxies > 0 && cfg.steps > 0 && cfg.batch > 0 );
+
+   mutable_variant_object footprints;
+   for( uint32_t step = 1; step <= cfg.steps; ++step ) {
+      grow_producers( std::max<uint32_t>( 21, cfg.producers * step / cfg.steps ) );
+      grow_proxies( std::max<uint32_t>( 1, cfg.proxies * step / cfg.steps ) );
+      grow_voters( std::max<uint32_t>( 1, uint64_t(cfg.voters) * step / cfg.steps ) );
+      if( step == 1 ) {
+         activate();
+      }
+
+      const std::string scenario = "producers=" + std::to_string( producers.size() ) + " proxies=" + std::to_string( proxies.size() )
+                                 + " voters=" + std::to_string( voters.size() );
+      const account_name direct_voter = voters.back();
+      const account_name proxy        = proxies.front();
+      const account_name delegator    = voters.front(); // votes through a proxy unless LOAD_PROXIED_PERCENT is 0
+
+      measure( scenario, config::system_account_name, N(voteproducer), direct_voter, mvo()
+               ("voter", direct_voter)("proxy", name(0))("producers", producer_window( step * 7 )) );
+      measure( scenario, config::system_account_name, N(voteproducer), proxy, mvo()
+               ("voter", proxy)("proxy", name(0))("producers", producer_window( step * 11 )) );
+      transfer( "eosio", delegator, core_sym::from_string("10.0000"), "eosio" );
+      measure( scenario, config::system_account_name, N(delegatebw), delegator, mvo()
+               ("from", delegator)("receiver", delegator)
+               ("stake_net_quantity", core_sym::from_string("5.0000"))("stake_cpu_quantity", core_sym::from_string("5.0000"))("transfer", 0) );
+
+      const account_name new_proxy = generated_account( "rgpx", step );
+      create_staked_accounts( { new_proxy }, core_sym::from_string("1.0000") );
+      measure( scenario, config::system_account_name, N(regproxy), new_proxy, mvo()("proxy", new_proxy)("isproxy", true) );
+
+      produce_block( fc::days(1) );
+      produce_blocks( 10 );
+      const account_name producer = control->head_block_producer();
+      BOOST_REQUIRE( producer != config::system_account_name );
+      measure( scenario, config::system_account_name, N(claimrewards), producer, mvo()("owner", producer) );
+
+      measure_onblock( scenario );
+
+      const auto tables = table_footprints( { config::system_account_name, N(eosio.token) } );
+      for( const auto& f : tables ) {
+         BOOST_TEST_MESSAGE( f.contract << " " << f.table << " (" << scenario << "): " << f.rows << " rows, "
+                             << f.billed_bytes << " billed bytes" );
+      }
+      footprints( scenario, tables );
+   }
+
+   for( const auto& cost : costs ) {
+      if( cost.elapsed_us ) {
+         BOOST_TEST_MESSAGE( cost.action << " (" << cost.scenario << "): " << cost.elapsed_us << " us elapsed" );
+      } else {
+         BOOST_TEST_MESSAGE( cost.action << " (" << cost.scenario << "): " << cost.cpu_usage_us << " us" );
+      }
+   }
+   if( const char* report = std::getenv( "BENCHMARK_REPORT" ) ) {
+      write_report( report );
+   }
+   if( const char* report = std::getenv( "FOOTPRINT_REPORT" ) ) {
+      fc::json::save_to_file( footprints, report, true );
+   }
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -2,6 +2,7 @@
 #include <eosio/testing/tester.hpp>
 #include <eosio/chain/abi_serializer.hpp>
 #include <eosio/chain/wast_to_wasm.hpp>
+#include <eosio/chain/resource_limits.hpp>
 
 #include <Runtime/Runtime.h>
 
@@ -221,6 +222,97 @@ BOOST_FIXTURE_TEST_CASE( propose_approve_execute, eosio_msig_tester ) try {
 } FC_LOG_AND_RETHROW()
 
 
+BOOST_FIXTURE_TEST_CASE( propose_approve_execute_immediate, eosio_msig_tester ) try {
+   auto trx = reqauth("alice", {permission_level{N(alice), config::active_name}}, abi_serializer_max_time );
+
+   push_action( N(alice), N(propose), mvo()
+                  ("proposer",      "alice")
+                  ("proposal_name", "first")
+                  ("trx",           trx)
+                  ("requested", vector<permission_level>{{ N(alice), config::active_name }})
+   );
+
+   //fail to execute before approval
+   BOOST_REQUIRE_EXCEPTION( push_action( N(alice), N(exec), mvo()
+                                          ("proposer",      "alice")
+                                          ("proposal_name", "first")
+                                          ("executer",      "alice")
+                                          ("immediate",     true)
+                            ),
+                            eosio_assert_message_exception,
+                            eosio_assert_message_is("transaction authorization failed")
+   );
+
+   push_action( N(alice), N(approve), mvo()
+                  ("proposer",      "alice")
+                  ("proposal_name", "first")
+                  ("level",         permission_level{ N(alice), config::active_name })
+   );
+
+   //the proposed action runs inline, no deferred transaction is scheduled
+   transaction_trace_ptr deferred_trace;
+   control->applied_transaction.connect([&]( const transaction_trace_ptr& t) { if (t->scheduled) { deferred_trace = t; } } );
+   auto trace = push_action( N(alice), N(exec), mvo()
+                               ("proposer",      "alice")
+                               ("proposal_name", "first")
+                               ("executer",      "alice")
+                               ("immediate",     true)
+   );
+
+   BOOST_REQUIRE( !deferred_trace );
+   BOOST_REQUIRE_EQUAL( transaction_receipt::executed, trace->receipt->status );
+   BOOST_REQUIRE_EQUAL( 1, trace->action_traces.size() );
+   BOOST_REQUIRE_EQUAL( 1, trace->action_traces[0].inline_traces.size() );
+   BOOST_REQUIRE_EQUAL( "eosio", name{trace->action_traces[0].inline_traces[0].act.account} );
+   BOOST_REQUIRE_EQUAL( "reqauth", name{trace->action_traces[0].inline_traces[0].act.name} );
+   BOOST_REQUIRE( get_row_by_account( N(eosio.msig), N(alice), N(proposal), N(first) ).empty() );
+} FC_LOG_AND_RETHROW()
+
+
+BOOST_FIXTURE_TEST_CASE( execute_immediate_with_delay, eosio_msig_tester ) try {
+   auto trx = reqauth("alice", {permission_level{N(alice), config::active_name}}, abi_serializer_max_time );
+   trx.delay_sec = 10;
+
+   push_action( N(alice), N(propose), mvo()
+                  ("proposer",      "alice")
+                  ("proposal_name", "first")
+                  ("trx",           trx)
+                  ("requested", vector<permission_level>{{ N(alice), config::active_name }})
+   );
+   push_action( N(alice), N(approve), mvo()
+                  ("proposer",      "alice")
+                  ("proposal_name", "first")
+                  ("level",         permission_level{ N(alice), config::active_name })
+   );
+
+   //delayed transactions can only be executed as deferred
+   BOOST_REQUIRE_EXCEPTION( push_action( N(alice), N(exec), mvo()
+                                          ("proposer",      "alice")
+                                          ("proposal_name", "first")
+                                          ("executer",      "alice")
+                                          ("immediate",     true)
+                            ),
+                            eosio_assert_message_exception,
+                            eosio_assert_message_is("immediate execution requires a transaction without delay")
+   );
+
+   transaction_trace_ptr trace;
+   control->applied_transaction.connect([&]( const transaction_trace_ptr& t) { if (t->scheduled) { trace = t; } } );
+   push_action( N(alice), N(exec), mvo()
+                  ("proposer",      "alice")
+                  ("proposal_name", "first")
+                  ("executer",      "alice")
+                  ("immediate",     false)
+   );
+   BOOST_REQUIRE( !trace );
+
+   produce_blocks( 20 );
+   BOOST_REQUIRE( bool(trace) );
+   BOOST_REQUIRE_EQUAL( 1, trace->action_traces.size() );
+   BOOST_REQUIRE_EQUAL( transaction_receipt::executed, trace->receipt->status );
+} FC_LOG_AND_RETHROW()
+
+
 BOOST_FIXTURE_TEST_CASE( propose_approve_unapprove, eosio_msig_tester ) try {
    auto trx = reqauth("alice", {permission_level{N(alice), config::active_name}}, abi_serializer_max_time );
 
@@ -947,4 +1039,575 @@ BOOST_FIXTURE_TEST_CASE( switch_proposal_and_fail_approve_with_hash, eosio_msig_
    );
 } FC_LOG_AND_RETHROW()
 
+BOOST_FIXTURE_TEST_CASE( approve_with_hash_old, eosio_msig_tester ) try {
+   set_code( N(eosio.msig), contracts::util::msig_wasm_old() );
+   set_abi( N(eosio.msig), contracts::util::msig_abi_old().data() );
+   produce_blocks();
+
+   //propose with old version of eosio.msig, the proposal row has no stored hash
+   auto trx = reqauth("alice", vector<permission_level>{ { N(alice), config::active_name }, { N(bob), config::active_name } }, abi_serializer_max_time );
+   auto trx_hash = fc::sha256::hash( trx );
+   auto not_trx_hash = fc::sha256::hash( trx_hash );
+   push_action( N(alice), N(propose), mvo()
+                  ("proposer",      "alice")
+                  ("proposal_name", "first")
+                  ("trx",           trx)
+                  ("requested", vector<permission_level>{ { N(alice), config::active_name }, { N(bob), config::active_name } })
+   );
+
+   set_code( N(eosio.msig), contracts::msig_wasm() );
+   set_abi( N(eosio.msig), contracts::msig_abi().data() );
+   produce_blocks();
+
+   //fail to approve with incorrect hash, the packed transaction is hashed because there is no stored digest
+   BOOST_REQUIRE_EXCEPTION( push_action( N(alice), N(approve), mvo()
+                                          ("proposer",      "alice")
+                                          ("proposal_name", "first")
+                                          ("level",         permission_level{ N(alice), config::active_name })
+                                          ("proposal_hash", not_trx_hash)
+                            ),
+                            eosio::chain::crypto_api_exception,
+                            fc_exception_message_is("hash mismatch")
+   );
+
+   //approval with correct hash leaves the proposal row as it is, so the proposer is not billed more ram
+   push_action( N(alice), N(approve), mvo()
+                  ("proposer",      "alice")
+                  ("proposal_name", "first")
+                  ("level",         permission_level{ N(alice), config::active_name })
+                  ("proposal_hash", trx_hash)
+   );
+   auto prop = abi_ser.binary_to_variant( "proposal", get_row_by_account( N(eosio.msig), N(alice), N(proposal), N(first) ), abi_serializer_max_time );
+   BOOST_REQUIRE( !prop.get_object().contains( "trx_hash" ) );
+
+   //later approvals hash the packed transaction again
+   BOOST_REQUIRE_EXCEPTION( push_action( N(bob), N(approve), mvo()
+                                          ("proposer",      "alice")
+                                          ("proposal_name", "first")
+                                          ("level",         permission_level{ N(bob), config::active_name })
+                                          ("proposal_hash", not_trx_hash)
+                            ),
+                            eosio::chain::crypto_api_exception,
+                            fc_exception_message_is("hash mismatch")
+   );
+   push_action( N(bob), N(approve), mvo()
+                  ("proposer",      "alice")
+                  ("proposal_name", "first")
+                  ("level",         permission_level{ N(bob), config::active_name })
+                  ("proposal_hash", trx_hash)
+   );
+
+   transaction_trace_ptr trace;
+   control->applied_transaction.connect([&]( const transaction_trace_ptr& t) { if (t->scheduled) { trace = t; } } );
+   push_action( N(alice), N(exec), mvo()
+                  ("proposer",      "alice")
+                  ("proposal_name", "first")
+                  ("executer",      "alice")
+   );
+
+   BOOST_REQUIRE( bool(trace) );
+   BOOST_REQUIRE_EQUAL( 1, trace->action_traces.size() );
+   BOOST_REQUIRE_EQUAL( transaction_receipt::executed, trace->receipt->status );
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( approve_with_hash_big_transaction, eosio_msig_tester ) try {
+   vector<permission_level> perm = { { N(alice), config::active_name }, { N(bob), config::active_name } };
+   bytes code( 300*1024 );
+   for( size_t i = 0; i < code.size(); ++i ) {
+      code[i] = char(i * 31);
+   }
+
+   variant pretty_trx = fc::mutable_variant_object()
+      ("expiration", "2020-01-01T00:30")
+      ("ref_block_num", 2)
+      ("ref_block_prefix", 3)
+      ("max_net_usage_words", 0)
+      ("max_cpu_usage_ms", 0)
+      ("delay_sec", 0)
+      ("actions", fc::variants({
+            fc::mutable_variant_object()
+               ("account", name(config::system_account_name))
+               ("name", "setcode")
+               ("authorization", perm)
+               ("data", fc::mutable_variant_object()
+                ("account", "alice")
+                ("vmtype", 0)
+                ("vmversion", 0)
+                ("code", code)
+               )
+               })
+      );
+
+   transaction trx;
+   abi_serializer::from_variant(pretty_trx, trx, get_resolver(), abi_serializer_max_time);
+   auto trx_hash = fc::sha256::hash( trx );
+   BOOST_REQUIRE( fc::raw::pack_size( trx ) > 300*1024 );
+
+   auto approve = [&]( name proposal_name, name approver, const fc::sha256& hash ) {
+      return push_action( approver, N(approve), mvo()
+                           ("proposer",      "alice")
+                           ("proposal_name", proposal_name)
+                           ("level",         permission_level{ approver, config::active_name })
+                           ("proposal_hash", hash)
+      );
+   };
+   auto not_trx_hash = fc::sha256::hash( trx_hash );
+   const auto& rlm = control->get_resource_limits_manager();
+
+   //proposal created by the old version: every approval hashes the transaction, without storing the digest
+   set_code( N(eosio.msig), contracts::util::msig_wasm_old() );
+   set_abi( N(eosio.msig), contracts::util::msig_abi_old().data() );
+   produce_blocks();
+   push_action( N(alice), N(propose), mvo()
+                  ("proposer",      "alice")
+                  ("proposal_name", "old")
+                  ("trx",           trx)
+                  ("requested", perm)
+   );
+   set_code( N(eosio.msig), contracts::msig_wasm() );
+   set_abi( N(eosio.msig), contracts::msig_abi().data() );
+   produce_blocks();
+
+   BOOST_REQUIRE_EXCEPTION( approve( N(old), N(alice), not_trx_hash ),
+                            eosio::chain::crypto_api_exception,
+                            fc_exception_message_is("hash mismatch")
+   );
+   const int64_t ram_usage = rlm.get_account_ram_usage( N(alice) );
+   approve( N(old), N(alice), trx_hash );
+   approve( N(old), N(bob), trx_hash );
+   BOOST_REQUIRE_EQUAL( ram_usage, rlm.get_account_ram_usage( N(alice) ) );
+
+   //proposal created by the current version: the digest is stored by propose and compared by approve
+   push_action( N(alice), N(propose), mvo()
+                  ("proposer",      "alice")
+                  ("proposal_name", "new")
+                  ("trx",           trx)
+                  ("requested", perm)
+   );
+   auto prop = abi_ser.binary_to_variant( "proposal", get_row_by_account( N(eosio.msig), N(alice), N(proposal), N(new) ), abi_serializer_max_time );
+   BOOST_REQUIRE_EQUAL( string(trx_hash), prop["trx_hash"].as_string() );
+
+   BOOST_REQUIRE_EXCEPTION( approve( N(new), N(alice), not_trx_hash ),
+                            eosio::chain::crypto_api_exception,
+                            fc_exception_message_is("hash mismatch")
+   );
+   approve( N(new), N(alice), trx_hash );
+   approve( N(new), N(bob), trx_hash );
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( blob_upload_propose_execute, eosio_msig_tester ) try {
+   vector<permission_level> perm = { { N(alice), config::active_name }, { N(bob), config::active_name } };
+   auto trx = reqauth("alice", perm, abi_serializer_max_time );
+   bytes packed = fc::raw::pack( trx );
+   auto trx_hash = fc::sha256::hash( packed.data(), packed.size() );
+   bytes first_chunk( packed.begin(), packed.begin() + packed.size() / 2 );
+   bytes second_chunk( packed.begin() + packed.size() / 2, packed.end() );
+
+   push_action( N(carol), N(beginblob), mvo()
+                  ("uploader",  "carol")
+                  ("blob_hash", trx_hash)
+                  ("size",      packed.size())
+   );
+   BOOST_REQUIRE_EXCEPTION( push_action( N(carol), N(beginblob), mvo()
+                                          ("uploader",  "carol")
+                                          ("blob_hash", trx_hash)
+                                          ("size",      packed.size())
+                            ),
+                            eosio_assert_message_exception,
+                            eosio_assert_message_is("upload with the same hash exists")
+   );
+   push_action( N(carol), N(appendblob), mvo()
+                  ("uploader",  "carol")
+                  ("blob_hash", trx_hash)
+                  ("offset",    0)
+                  ("data",      first_chunk)
+   );
+   //chunks have to be appended in order
+   BOOST_REQUIRE_EXCEPTION( push_action( N(carol), N(appendblob), mvo()
+                                          ("uploader",  "carol")
+                                          ("blob_hash", trx_hash)
+                                          ("offset",    0)
+                                          ("data",      second_chunk)
+                            ),
+                            eosio_assert_message_exception,
+                            eosio_assert_message_is("chunk offset doesn't match uploaded size")
+   );
+   BOOST_REQUIRE_EXCEPTION( push_action( N(carol), N(finalizeblob), mvo()
+                                          ("uploader",  "carol")
+                                          ("blob_hash", trx_hash)
+                            ),
+                            eosio_assert_message_exception,
+                            eosio_assert_message_is("blob upload is incomplete")
+   );
+   //cannot propose before the upload is finalized
+   BOOST_REQUIRE_EXCEPTION( push_action( N(alice), N(proposeblob), mvo()
+                                          ("proposer",      "alice")
+                                          ("proposal_name", "first")
+                                          ("requested",     perm)
+                                          ("trx_hash",      trx_hash)
+                            ),
+                            eosio_assert_message_exception,
+                            eosio_assert_message_is("blob not found")
+   );
+   push_action( N(carol), N(appendblob), mvo()
+                  ("uploader",  "carol")
+                  ("blob_hash", trx_hash)
+                  ("offset",    first_chunk.size())
+                  ("data",      second_chunk)
+   );
+   push_action( N(carol), N(finalizeblob), mvo()
+                  ("uploader",  "carol")
+                  ("blob_hash", trx_hash)
+   );
+
+   //two proposals share the same blob
+   push_action( N(alice), N(proposeblob), mvo()
+                  ("proposer",      "alice")
+                  ("proposal_name", "first")
+                  ("requested",     perm)
+                  ("trx_hash",      trx_hash)
+   );
+   push_action( N(bob), N(proposeblob), mvo()
+                  ("proposer",      "bob")
+                  ("proposal_name", "second")
+                  ("requested",     perm)
+                  ("trx_hash",      trx_hash)
+   );
+   auto blob = abi_ser.binary_to_variant( "blob", get_row_by_account( N(eosio.msig), N(eosio.msig), N(blobs), 0 ), abi_serializer_max_time );
+   BOOST_REQUIRE_EQUAL( 2, blob["references"].as_uint64() );
+   BOOST_REQUIRE_EXCEPTION( push_action( N(carol), N(cancelblob), mvo()
+                                          ("uploader",  "carol")
+                                          ("blob_hash", trx_hash)
+                            ),
+                            eosio_assert_message_exception,
+                            eosio_assert_message_is("blob is referenced by proposals")
+   );
+
+   //approve with hash and execute the first proposal
+   for( auto& level : perm ) {
+      push_action( level.actor, N(approve), mvo()
+                     ("proposer",      "alice")
+                     ("proposal_name", "first")
+                     ("level",         level)
+                     ("proposal_hash", trx_hash)
+      );
+   }
+   transaction_trace_ptr trace;
+   control->applied_transaction.connect([&]( const transaction_trace_ptr& t) { if (t->scheduled) { trace = t; } } );
+   push_action( N(alice), N(exec), mvo()
+                  ("proposer",      "alice")
+                  ("proposal_name", "first")
+                  ("executer",      "alice")
+   );
+   BOOST_REQUIRE( bool(trace) );
+   BOOST_REQUIRE_EQUAL( 1, trace->action_traces.size() );
+   BOOST_REQUIRE_EQUAL( transaction_receipt::executed, trace->receipt->status );
+
+   blob = abi_ser.binary_to_variant( "blob", get_row_by_account( N(eosio.msig), N(eosio.msig), N(blobs), 0 ), abi_serializer_max_time );
+   BOOST_REQUIRE_EQUAL( 1, blob["references"].as_uint64() );
+
+   //canceling the last proposal removes the blob
+   push_action( N(bob), N(cancel), mvo()
+                  ("proposer",      "bob")
+                  ("proposal_name", "second")
+                  ("canceler",      "bob")
+   );
+   BOOST_REQUIRE( get_row_by_account( N(eosio.msig), N(eosio.msig), N(blobs), 0 ).empty() );
+   BOOST_REQUIRE( get_row_by_account( N(eosio.msig), N(eosio.msig), N(blobdata), 0 ).empty() );
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( blob_hash_mismatch, eosio_msig_tester ) try {
+   auto trx = reqauth("alice", {permission_level{N(alice), config::active_name}}, abi_serializer_max_time );
+   bytes packed = fc::raw::pack( trx );
+   auto wrong_hash = fc::sha256::hash( std::string("wrong") );
+
+   push_action( N(carol), N(beginblob), mvo()
+                  ("uploader",  "carol")
+                  ("blob_hash", wrong_hash)
+                  ("size",      packed.size())
+   );
+   push_action( N(carol), N(appendblob), mvo()
+                  ("uploader",  "carol")
+                  ("blob_hash", wrong_hash)
+                  ("offset",    0)
+                  ("data",      packed)
+   );
+   BOOST_REQUIRE_EXCEPTION( push_action( N(carol), N(finalizeblob), mvo()
+                                          ("uploader",  "carol")
+                                          ("blob_hash", wrong_hash)
+                            ),
+                            crypto_api_exception,
+                            fc_exception_message_is("hash mismatch")
+   );
+
+   //incomplete or broken uploads can be removed by the uploader
+   push_action( N(carol), N(cancelblob), mvo()
+                  ("uploader",  "carol")
+                  ("blob_hash", wrong_hash)
+   );
+   BOOST_REQUIRE( get_row_by_account( N(eosio.msig), N(carol), N(uploads), 0 ).empty() );
+   BOOST_REQUIRE( get_row_by_account( N(eosio.msig), N(carol), N(blobchunks), 0 ).empty() );
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( blob_upload_not_blocked_by_other_uploader, eosio_msig_tester ) try {
+   vector<permission_level> perm = { { N(alice), config::active_name } };
+   auto trx = reqauth("alice", perm, abi_serializer_max_time );
+   bytes packed = fc::raw::pack( trx );
+   auto trx_hash = fc::sha256::hash( packed.data(), packed.size() );
+
+   //bob starts uploading the same hash and never finishes
+   push_action( N(bob), N(beginblob), mvo()
+                  ("uploader",  "bob")
+                  ("blob_hash", trx_hash)
+                  ("size",      packed.size())
+   );
+   BOOST_REQUIRE_EXCEPTION( push_action( N(carol), N(appendblob), mvo()
+                                          ("uploader",  "carol")
+                                          ("blob_hash", trx_hash)
+                                          ("offset",    0)
+                                          ("data",      packed)
+                            ),
+                            eosio_assert_message_exception,
+                            eosio_assert_message_is("upload not found")
+   );
+
+   //carol uploads it anyway and alice can propose it
+   push_action( N(carol), N(beginblob), mvo()
+                  ("uploader",  "carol")
+                  ("blob_hash", trx_hash)
+                  ("size",      packed.size())
+   );
+   push_action( N(carol), N(appendblob), mvo()
+                  ("uploader",  "carol")
+                  ("blob_hash", trx_hash)
+                  ("offset",    0)
+                  ("data",      packed)
+   );
+   push_action( N(carol), N(finalizeblob), mvo()
+                  ("uploader",  "carol")
+                  ("blob_hash", trx_hash)
+   );
+   push_action( N(alice), N(proposeblob), mvo()
+                  ("proposer",      "alice")
+                  ("proposal_name", "first")
+                  ("requested",     perm)
+                  ("trx_hash",      trx_hash)
+   );
+
+   //the finalized blob belongs to carol, bob can only drop his own upload
+   BOOST_REQUIRE_EXCEPTION( push_action( N(bob), N(beginblob), mvo()
+                                          ("uploader",  "bob")
+                                          ("blob_hash", trx_hash)
+                                          ("size",      packed.size())
+                            ),
+                            eosio_assert_message_exception,
+                            eosio_assert_message_is("blob with the same hash exists")
+   );
+   push_action( N(bob), N(cancelblob), mvo()
+                  ("uploader",  "bob")
+                  ("blob_hash", trx_hash)
+   );
+   BOOST_REQUIRE( get_row_by_account( N(eosio.msig), N(bob), N(uploads), 0 ).empty() );
+   BOOST_REQUIRE_EXCEPTION( push_action( N(bob), N(cancelblob), mvo()
+                                          ("uploader",  "bob")
+                                          ("blob_hash", trx_hash)
+                            ),
+                            eosio_assert_message_exception,
+                            eosio_assert_message_is("blob belongs to another uploader")
+   );
+   auto blob = abi_ser.binary_to_variant( "blob", get_row_by_account( N(eosio.msig), N(eosio.msig), N(blobs), 0 ), abi_serializer_max_time );
+   BOOST_REQUIRE_EQUAL( "carol", blob["uploader"].as_string() );
+   BOOST_REQUIRE_EQUAL( 1, blob["references"].as_uint64() );
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( cleanup_expired_proposals, eosio_msig_tester ) try {
+   auto trx = reqauth("alice", {permission_level{N(alice), config::active_name}}, abi_serializer_max_time );
+   auto later_trx = trx;
+   later_trx.expiration = time_point_sec( trx.expiration.sec_since_epoch() + 3600 );
+
+   for( auto proposal_name : { N(first), N(second) } ) {
+      push_action( N(alice), N(propose), mvo()
+                     ("proposer",      "alice")
+                     ("proposal_name", proposal_name)
+                     ("trx",           trx)
+                     ("requested", vector<permission_level>{{ N(alice), config::active_name }})
+      );
+   }
+   push_action( N(bob), N(propose), mvo()
+                  ("proposer",      "bob")
+                  ("proposal_name", "later")
+                  ("trx",           later_trx)
+                  ("requested", vector<permission_level>{{ N(alice), config::active_name }})
+   );
+
+   //nothing to remove before expiration
+   BOOST_REQUIRE_EXCEPTION( push_action( N(carol), N(cleanup), mvo()
+                                          ("max_rows", 10)
+                            ),
+                            eosio_assert_message_exception,
+                            eosio_assert_message_is("no expired proposals")
+   );
+
+   produce_block( fc::minutes(31) );
+   produce_blocks();
+
+   //anyone can remove expired proposals, at most max_rows at a time
+   push_action( N(carol), N(cleanup), mvo()
+                  ("max_rows", 1)
+   );
+   BOOST_REQUIRE( get_row_by_account( N(eosio.msig), N(alice), N(proposal), N(first) ).empty() ^
+                  get_row_by_account( N(eosio.msig), N(alice), N(proposal), N(second) ).empty() );
+
+   push_action( N(carol), N(cleanup), mvo()
+                  ("max_rows", 10)
+   );
+   for( auto proposal_name : { N(first), N(second) } ) {
+      BOOST_REQUIRE( get_row_by_account( N(eosio.msig), N(alice), N(proposal), proposal_name ).empty() );
+      BOOST_REQUIRE( get_row_by_account( N(eosio.msig), N(alice), N(approvals2), proposal_name ).empty() );
+   }
+   BOOST_REQUIRE( !get_row_by_account( N(eosio.msig), N(bob), N(proposal), N(later) ).empty() );
+
+   BOOST_REQUIRE_EXCEPTION( push_action( N(carol), N(cleanup), mvo()
+                                          ("max_rows", 10)
+                            ),
+                            eosio_assert_message_exception,
+                            eosio_assert_message_is("no expired proposals")
+   );
+
+   //canceled proposals are removed from the expiration index
+   push_action( N(bob), N(cancel), mvo()
+                  ("proposer",      "bob")
+                  ("proposal_name", "later")
+                  ("canceler",      "bob")
+   );
+   produce_block( fc::hours(1) );
+   produce_blocks();
+   BOOST_REQUIRE_EXCEPTION( push_action( N(carol), N(cleanup), mvo()
+                                          ("max_rows", 10)
+                            ),
+                            eosio_assert_message_exception,
+                            eosio_assert_message_is("no expired proposals")
+   );
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( cleanup_indexed_old_proposal, eosio_msig_tester ) try {
+   set_code( N(eosio.msig), contracts::util::msig_wasm_old() );
+   set_abi( N(eosio.msig), contracts::util::msig_abi_old().data() );
+   produce_blocks();
+
+   //proposals created by the old version are not in the expiration index
+   auto trx = reqauth("alice", {permission_level{N(alice), config::active_name}}, abi_serializer_max_time );
+   push_action( N(alice), N(propose), mvo()
+                  ("proposer",      "alice")
+                  ("proposal_name", "first")
+                  ("trx",           trx)
+                  ("requested", vector<permission_level>{{ N(alice), config::active_name }})
+   );
+
+   set_code( N(eosio.msig), contracts::msig_wasm() );
+   set_abi( N(eosio.msig), contracts::msig_abi().data() );
+   produce_block( fc::minutes(31) );
+   produce_blocks();
+
+   BOOST_REQUIRE_EXCEPTION( push_action( N(carol), N(cleanup), mvo()
+                                          ("max_rows", 10)
+                            ),
+                            eosio_assert_message_exception,
+                            eosio_assert_message_is("no expired proposals")
+   );
+
+   //anyone can add it to the index, once
+   push_action( N(carol), N(index), mvo()
+                  ("proposer",      "alice")
+                  ("proposal_name", "first")
+                  ("payer",         "carol")
+   );
+   BOOST_REQUIRE_EXCEPTION( push_action( N(carol), N(index), mvo()
+                                          ("proposer",      "alice")
+                                          ("proposal_name", "first")
+                                          ("payer",         "carol")
+                            ),
+                            eosio_assert_message_exception,
+                            eosio_assert_message_is("proposal is already indexed")
+   );
+
+   push_action( N(carol), N(cleanup), mvo()
+                  ("max_rows", 10)
+   );
+   BOOST_REQUIRE( get_row_by_account( N(eosio.msig), N(alice), N(proposal), N(first) ).empty() );
+   BOOST_REQUIRE( get_row_by_account( N(eosio.msig), N(alice), N(approvals), N(first) ).empty() );
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( approve_batch, eosio_msig_tester ) try {
+   auto trx = reqauth("alice", {permission_level{N(alice), config::active_name}}, abi_serializer_max_time );
+
+   push_action( N(alice), N(propose), mvo()
+                  ("proposer",      "alice")
+                  ("proposal_name", "first")
+                  ("trx",           trx)
+                  ("requested", vector<permission_level>{{ N(alice), config::active_name }})
+   );
+   push_action( N(bob), N(propose), mvo()
+                  ("proposer",      "bob")
+                  ("proposal_name", "second")
+                  ("trx",           trx)
+                  ("requested", vector<permission_level>{{ N(alice), config::active_name }})
+   );
+   push_action( N(bob), N(propose), mvo()
+                  ("proposer",      "bob")
+                  ("proposal_name", "third")
+                  ("trx",           trx)
+                  ("requested", vector<permission_level>{{ N(bob), config::active_name }})
+   );
+
+   //the whole batch fails if one of the approvals is not requested
+   BOOST_REQUIRE_EXCEPTION( push_action( N(alice), N(approvebatch), mvo()
+                                          ("level",     permission_level{ N(alice), config::active_name })
+                                          ("proposals", fc::variants({
+                                                mvo()("proposer", "alice")("proposal_name", "first"),
+                                                mvo()("proposer", "bob")("proposal_name", "third")
+                                             }))
+                            ),
+                            eosio_assert_message_exception,
+                            eosio_assert_message_is("approval is not on the list of requested approvals")
+   );
+
+   push_action( N(alice), N(approvebatch), mvo()
+                  ("level",     permission_level{ N(alice), config::active_name })
+                  ("proposals", fc::variants({
+                        mvo()("proposer", "alice")("proposal_name", "first"),
+                        mvo()("proposer", "bob")("proposal_name", "second")
+                     }))
+   );
+
+   //approving again fails
+   BOOST_REQUIRE_EXCEPTION( push_action( N(alice), N(approve), mvo()
+                                          ("proposer",      "bob")
+                                          ("proposal_name", "second")
+                                          ("level",         permission_level{ N(alice), config::active_name })
+                            ),
+                            eosio_assert_message_exception,
+                            eosio_assert_message_is("approval is not on the list of requested approvals")
+   );
+
+   vector<transaction_trace_ptr> traces;
+   control->applied_transaction.connect([&]( const transaction_trace_ptr& t) { if (t->scheduled) { traces.push_back( t ); } } );
+   push_action( N(alice), N(exec), mvo()
+                  ("proposer",      "alice")
+                  ("proposal_name", "first")
+                  ("executer",      "alice")
+   );
+   push_action( N(bob), N(exec), mvo()
+                  ("proposer",      "bob")
+                  ("proposal_name", "second")
+                  ("executer",      "bob")
+   );
+
+   BOOST_REQUIRE_EQUAL( 2, traces.size() );
+   for( auto& trace : traces ) {
+      BOOST_REQUIRE_EQUAL( 1, trace->action_traces.size() );
+      BOOST_REQUIRE_EQUAL( transaction_receipt::executed, trace->receipt->status );
+   }
+} FC_LOG_AND_RETHROW()
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,266 @@
+#include <boost/test/unit_test.hpp>
+#include <eosio/chain/contract_table_objects.hpp>
+#include <eosio/chain/global_property_object.hpp>
+#include <eosio/chain/resource_limits.hpp>
+#include <eosio/chain/wast_to_wasm.hpp>
+#include <cstdlib>
+#include <iostream>
+#include <fc/log/logger.hpp>
+#include <eosio/chain/exceptions.hpp>
+#include <Runtime/Runtime.h>
+
+#include "eosio.benchmark_tester.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iterator>
+#include <set>
+
+using namespace eosio_system;
+
+namespace {
+
+/**
+ * Settings of the replay, read from the environment
+ */
+struct replay_config {
+   std::string file    = std::getenv( "REPLAY_FILE" ) ? std::getenv( "REPLAY_FILE" ) : contracts::util::action_mix();
+   uint64_t    balance = env_uint( "REPLAY_BALANCE", 10000 ); ///< liquid tokens given to every account of the recording
+   uint64_t    stake   = env_uint( "REPLAY_STAKE", 1000 );    ///< tokens staked for net and for cpu by every account of the recording
+   uint32_t    batch   = env_uint( "REPLAY_BATCH", 20 );      ///< accounts created or funded per transaction
+};
+
+/**
+ * One line of the recording: {"contract":"eosio.token","action":"transfer","actor":"...","data":{...}}
+ */
+struct replay_record {
+   account_name  contract;
+   action_name   action;
+   account_name  actor;
+   variant_object data;
+};
+
+/**
+ * Transactions packed into one replayed block
+ */
+struct replay_block {
+   uint32_t actions      = 0;
+   uint64_t cpu_usage_us = 0;
+   uint64_t net_usage    = 0;
+};
+
+/// value below which 'percent' percent of the sorted 'values' fall, by nearest rank
+uint64_t percentile( const std::vector<uint32_t>& values, uint32_t percent ) {
+   const size_t rank = std::ceil( values.size() * percent / 100.0 );
+   return values[std::max<size_t>( rank, 1 ) - 1];
+}
+
+class eosio_replay_tester : public eosio_benchmark_tester {
+public:
+   replay_config cfg;
+
+   std::vector<replay_record> records;
+   std::vector<replay_block>  blocks;
+   std::map<std::string, std::vector<uint32_t>> cpu_usage; ///< of the replayed transactions, keyed by "<contract>::<action>"
+   std::vector<std::string>   failures;
+
+   /// recordings use the SYS symbol for the core token, which is replaced by the symbol the tests are built with
+   void load( const std::string& path ) {
+      std::ifstream in( path );
+      BOOST_REQUIRE_MESSAGE( bool(in), "cannot read " + path );
+      std::string line;
+      while( std::getline( in, line ) ) {
+         if( line.empty() ) continue;
+         for( auto pos = line.find( " SYS\"" ); pos != std::string::npos; pos = line.find( " SYS\"", pos + 1 ) ) {
+            line.replace( pos + 1, 3, CORE_SYM_NAME );
+         }
+         const auto record = fc::json::from_string( line ).get_object();
+         records.push_back( replay_record{ account_name( record["contract"].as_string() ), action_name( record["action"].as_string() ),
+                                           account_name( record["actor"].as_string() ), record["data"].get_object() } );
+      }
+   }
+
+   bool exists( const account_name& a )const {
+      return control->db().find<account_object,by_name>( a ) != nullptr;
+   }
+
+   /**
+    * Creates, funds and stakes the accounts the recording refers to, registers its producers and proxies and
+    * activates the chain so that the producers can claim their rewards
+    */
+   void prepare() {
+      static const char* const account_fields[] = { "from", "to", "payer", "receiver", "voter", "proxy", "owner", "producer" };
+      std::set<account_name> accounts, producers, proxies;
+      for( const auto& r : records ) {
+         accounts.insert( r.actor );
+         for( const char* field : account_fields ) {
+            if( r.data.contains( field ) ) {
+               accounts.insert( account_name( r.data[field].as_string() ) );
+            }
+         }
+         if( r.action == N(voteproducer) ) {
+            if( r.data.contains( "producers" ) ) {
+               for( const auto& p : r.data["producers"].get_array() ) {
+                  producers.insert( account_name( p.as_string() ) );
+               }
+            }
+            if( r.data.contains( "proxy" ) && !r.data["proxy"].as_string().empty() ) {
+               proxies.insert( account_name( r.data["proxy"].as_string() ) );
+            }
+         } else if( r.action == N(claimrewards) ) {
+            producers.insert( r.actor );
+         }
+      }
+      accounts.insert( producers.begin(), producers.end() );
+      accounts.erase( account_name() );
+
+      std::vector<account_name> created;
+      std::copy_if( accounts.begin(), accounts.end(), std::back_inserter( created ), [&]( const account_name& a ) { return !exists( a ); } );
+      create_staked_accounts( created, asset( cfg.stake * 10000, symbol{CORE_SYM} ), cfg.batch );
+      fund( created, asset( cfg.balance * 10000, symbol{CORE_SYM} ) );
+
+      const std::vector<account_name> registered( producers.begin(), producers.end() );
+      push_batched( registered, N(regproducer), [&]( size_t j ) {
+         return mvo()("producer", registered[j])("producer_key", get_public_key( registered[j], "active" ))
+                     ("url", "https://" + registered[j].to_string() + ".example")("location", 0);
+      }, cfg.batch );
+      const std::vector<account_name> registered_proxies( proxies.begin(), proxies.end() );
+      push_batched( registered_proxies, N(regproxy), [&]( size_t j ) {
+         return mvo()("proxy", registered_proxies[j])("isproxy", true);
+      }, cfg.batch );
+
+      if( !registered.empty() ) {
+         transfer( "eosio", "alice1111111", core_sym::from_string("300000000.0000"), "eosio" );
+         BOOST_REQUIRE_EQUAL( success(), stake( "alice1111111", "alice1111111", core_sym::from_string("100000000.0000"), core_sym::from_string("100000000.0000") ) );
+         std::vector<account_name> elected( registered.begin(), registered.begin() + std::min<size_t>( 30, registered.size() ) );
+         BOOST_REQUIRE_EQUAL( success(), push_action( N(alice1111111), N(voteproducer), mvo()
+                                                      ("voter", "alice1111111")("proxy", name(0))("producers", elected) ) );
+         produce_block( fc::days(1) );
+      }
+      // lets the elastic cpu and net limits of the accounts grow back before the replay
+      produce_blocks( 250 );
+   }
+
+   /// transfers 'quantity' from eosio to every account, in batches
+   void fund( const std::vector<account_name>& accounts, const asset& quantity ) {
+      for( size_t i = 0; i < accounts.size(); i += cfg.batch ) {
+         signed_transaction trx;
+         for( size_t j = i; j < std::min<size_t>( accounts.size(), i + cfg.batch ); ++j ) {
+            trx.actions.emplace_back( get_action( N(eosio.token), N(transfer),
+                                                  vector<permission_level>{ { config::system_account_name, config::active_name } },
+                                                  mvo()("from", "eosio")("to", accounts[j])("quantity", quantity)("memo", "replay") ) );
+         }
+         set_transaction_headers( trx );
+         trx.sign( get_private_key( config::system_account_name, "active" ), control->get_chain_id() );
+         push_transaction( trx );
+         produce_block();
+      }
+   }
+
+   /**
+    * Pushes every record in its own transaction, packing as many as the block limits allow into each block
+    */
+   void replay() {
+      replay_block current;
+      auto close_block = [&]() {
+         produce_block();
+         blocks.push_back( current );
+         current = replay_block();
+      };
+      for( const auto& r : records ) {
+         const std::string action = r.contract.to_string() + "::" + r.action.to_string();
+         transaction_trace_ptr trace;
+         for( int attempt = 0; attempt < 2 && !trace; ++attempt ) {
+            try {
+               // distinct expiration deltas keep identical records packed into one block from being duplicates
+               trace = push_billed_action( r.contract, r.action, r.actor, r.data, DEFAULT_EXPIRATION_DELTA + current.actions % 3000 );
+            } catch( const fc::exception& e ) {
+               const bool block_full = e.code() == block_cpu_usage_exceeded::code_value || e.code() == block_net_usage_exceeded::code_value;
+               if( block_full && attempt == 0 && current.actions > 0 ) {
+                  close_block();
+                  continue;
+               }
+               failures.push_back( action + ": " + e.top_message() );
+               break;
+            }
+         }
+         if( !trace ) continue;
+         ++current.actions;
+         current.cpu_usage_us += trace->receipt->cpu_usage_us;
+         current.net_usage    += trace->receipt->net_usage_words.value * 8;
+         cpu_usage[action].push_back( trace->receipt->cpu_usage_us );
+      }
+      if( current.actions > 0 ) {
+         close_block();
+      }
+   }
+};
+
+} /// namespace
+
+BOOST_AUTO_TEST_SUITE(eosio_replay_tests)
+
+// Replays the recorded mix of token and system actions in tests/action_mix.jsonl, or in the file in REPLAY_FILE,
+// packing as many transactions into each block as its cpu and net limits allow. Reports the actions replayed per
+// second, the cpu percentiles of each action and how full the blocks were, and writes them to the file in
+// REPLAY_REPORT when it is set.
+BOOST_FIXTURE_TEST_CASE( action_mix_throughput, eosio_replay_tester ) try {
+   load( cfg.file );
+   BOOST_REQUIRE( !records.empty() && cfg.batch > 0 );
+   prepare();
+
+   const auto start = fc::time_point::now();
+   replay();
+   const double seconds = std::max<int64_t>( ( fc::time_point::now() - start ).count(), 1 ) / 1000000.0;
+
+   for( const auto& f : failures ) {
+      BOOST_TEST_MESSAGE( "failed " << f );
+   }
+   if( cfg.file == contracts::util::action_mix() ) {
+      BOOST_REQUIRE_EQUAL( 0u, failures.size() );
+   }
+   BOOST_REQUIRE( !blocks.empty() );
+
+   const auto& limits = control->get_global_properties().configuration;
+   uint64_t actions = 0, cpu_total = 0;
+   double cpu_fill = 0, net_fill = 0, max_cpu_fill = 0;
+   for( const auto& b : blocks ) {
+      actions   += b.actions;
+      cpu_total += b.cpu_usage_us;
+      cpu_fill  += 100.0 * b.cpu_usage_us / limits.max_block_cpu_usage;
+      net_fill  += 100.0 * b.net_usage / limits.max_block_net_usage;
+      max_cpu_fill = std::max( max_cpu_fill, 100.0 * b.cpu_usage_us / limits.max_block_cpu_usage );
+   }
+
+   fc::variants per_action;
+   for( auto& a : cpu_usage ) {
+      std::sort( a.second.begin(), a.second.end() );
+      per_action.push_back( mvo()
+         ("action", a.first)("count", a.second.size())
+         ("p50_cpu_usage_us", percentile( a.second, 50 ))("p90_cpu_usage_us", percentile( a.second, 90 ))
+         ("p99_cpu_usage_us", percentile( a.second, 99 ))("max_cpu_usage_us", a.second.back()) );
+      BOOST_TEST_MESSAGE( a.first << ": " << a.second.size() << " actions, p50 " << percentile( a.second, 50 ) << " us, p90 "
+                          << percentile( a.second, 90 ) << " us, p99 " << percentile( a.second, 99 ) << " us, max " << a.second.back() << " us" );
+   }
+   BOOST_TEST_MESSAGE( actions << " actions in " << blocks.size() << " blocks, " << actions / seconds << " actions/s, "
+                       << actions * 1000000.0 / std::max<uint64_t>( cpu_total, 1 ) << " actions per billed cpu second, blocks "
+                       << cpu_fill / blocks.size() << "% cpu full on average and " << max_cpu_fill << "% at most, "
+                       << net_fill / blocks.size() << "% net full on average" );
+
+   if( const char* report = std::getenv( "REPLAY_REPORT" ) ) {
+      fc::json::save_to_file( mvo()
+         ("file", cfg.file)
+         ("actions", actions)
+         ("failures", failures)
+         ("blocks", blocks.size())
+         ("actions_per_second", actions / seconds)
+         ("actions_per_cpu_second", actions * 1000000.0 / std::max<uint64_t>( cpu_total, 1 ))
+         ("average_cpu_fill_percent", cpu_fill / blocks.size())
+         ("max_cpu_fill_percent", max_cpu_fill)
+         ("average_net_fill_percent", net_fill / blocks.size())
+         ("per_action", per_action), report, true );
+   }
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -6,11 +6,13 @@
 
 #include <eosio/testing/tester.hpp>
 #include <eosio/chain/abi_serializer.hpp>
+#include <eosio/chain/snapshot.hpp>
 #include "contracts.hpp"
 #include "test_symbol.hpp"
 
 #include <fc/variant_object.hpp>
 #include <fstream>
+#include <map>
 
 using namespace eosio::chain;
 using namespace eosio::testing;
@@ -92,12 +94,34 @@ public:
       minimal,
       core_token,
       deploy_contract,
-      full
+      full,
+      activated ///< full setup with 21 producers voted in by active_and_vote_producers
    };
 
+   /**
+    * The chain of each setup level is built once per process and restored from a snapshot by later
+    * fixtures of the same level, unless unit_test is run with --no-snapshot-cache
+    */
    eosio_system_tester( setup_level l = setup_level::full ) {
       if( l == setup_level::none ) return;
 
+      if( snapshot_cache_enabled() ) {
+         auto itr = snapshot_cache().find( l );
+         if( itr != snapshot_cache().end() ) {
+            restore_chain( itr->second );
+            load_abis( l );
+            return;
+         }
+      }
+
+      setup( l );
+
+      if( snapshot_cache_enabled() ) {
+         snapshot_cache()[l] = cache_chain();
+      }
+   }
+
+   void setup( setup_level l ) {
       basic_setup();
       if( l == setup_level::minimal ) return;
 
@@ -108,6 +132,103 @@ public:
       if( l == setup_level::deploy_contract ) return;
 
       remaining_setup();
+      if( l == setup_level::full ) return;
+
+      active_and_vote_producers();
+   }
+
+   static bool& snapshot_cache_enabled() {
+      static bool enabled = true;
+      return enabled;
+   }
+
+   /**
+    * State of the chain at the end of a setup: the snapshot of its head block and the transactions of its
+    * pending block, which a snapshot cannot hold
+    */
+   struct cached_chain {
+      fc::variant                                          snapshot;
+      std::vector<std::pair<packed_transaction, uint32_t>> pending; ///< with the cpu they were billed
+      map<account_name, block_id_type>                     last_produced_block;
+      map<transaction_id_type, transaction_receipt>        chain_transactions;
+   };
+
+   static std::map<setup_level, cached_chain>& snapshot_cache() {
+      static std::map<setup_level, cached_chain> cache;
+      return cache;
+   }
+
+   /// takes the snapshot and pushes the pending transactions again, leaving the chain as the setup left it
+   cached_chain cache_chain() {
+      cached_chain c;
+      c.last_produced_block = last_produced_block;
+      c.chain_transactions  = chain_transactions;
+      if( control->pending_block_state() ) {
+         for( const auto& r : control->pending_block_state()->block->transactions ) {
+            FC_ASSERT( r.trx.contains<packed_transaction>(), "setup cannot leave deferred transactions in the pending block" );
+            c.pending.emplace_back( r.trx.get<packed_transaction>(), r.cpu_usage_us );
+         }
+      }
+      c.snapshot = take_snapshot();
+      for( const auto& trx : control->get_unapplied_transactions() ) {
+         control->drop_unapplied_transaction( trx );
+      }
+      push_pending( c );
+      return c;
+   }
+
+   void restore_chain( const cached_chain& c ) {
+      restore_snapshot( c.snapshot );
+      last_produced_block = c.last_produced_block;
+      chain_transactions  = c.chain_transactions;
+      push_pending( c );
+   }
+
+   void push_pending( const cached_chain& c ) {
+      for( const auto& p : c.pending ) {
+         auto trx = p.first;
+         push_transaction( trx, fc::time_point::maximum(), p.second );
+      }
+   }
+
+   fc::variant take_snapshot() {
+      control->abort_block();
+
+      fc::mutable_variant_object snapshot;
+      auto writer = std::make_shared<variant_snapshot_writer>( snapshot );
+      control->write_snapshot( writer );
+      writer->finalize();
+      return fc::variant( snapshot );
+   }
+
+   void restore_snapshot( const fc::variant& snapshot ) {
+      close();
+      fc::remove_all( cfg.blocks_dir );
+      fc::remove_all( cfg.state_dir );
+      open( std::make_shared<variant_snapshot_reader>( snapshot ) );
+      last_produced_block.clear();
+#ifndef NON_VALIDATING_TEST
+      validating_node.reset();
+      fc::remove_all( vcfg.blocks_dir );
+      fc::remove_all( vcfg.state_dir );
+      validating_node = std::make_unique<controller>( vcfg );
+      validating_node->add_indices();
+      validating_node->startup( std::make_shared<variant_snapshot_reader>( snapshot ) );
+#endif
+   }
+
+   abi_def get_abi_def( account_name a ) {
+      const auto& accnt = control->db().get<account_object,by_name>( a );
+      abi_def abi;
+      BOOST_REQUIRE_EQUAL(abi_serializer::to_abi(accnt.abi, abi), true);
+      return abi;
+   }
+
+   void load_abis( setup_level l ) {
+      token_abi_ser.set_abi( get_abi_def( N(eosio.token) ), abi_serializer_max_time );
+      if( l >= setup_level::deploy_contract ) {
+         abi_ser.set_abi( get_abi_def( config::system_account_name ), abi_serializer_max_time );
+      }
    }
 
    template<typename Lambda>
@@ -372,7 +493,29 @@ public:
 
    fc::variant get_total_stake( const account_name& act ) {
       vector<char> data = get_row_by_account( config::system_account_name, act, N(userres), act );
-      return data.empty() ? fc::variant() : abi_ser.binary_to_variant( "user_resources", data, abi_serializer_max_time );
+      // accounts which never staked or bought ram have no row
+      return data.empty() ? fc::variant( mvo()
+                                         ("owner", act)
+                                         ("net_weight", core_sym::from_string("0.0000"))
+                                         ("cpu_weight", core_sym::from_string("0.0000"))
+                                         ("ram_bytes", 0) )
+                          : abi_ser.binary_to_variant( "user_resources", data, abi_serializer_max_time );
+   }
+
+   int64_t get_unsettled_ram_fees() {
+      vector<char> data = get_row_by_account( config::system_account_name, config::system_account_name, N(ramfees), N(ramfees) );
+      return data.empty() ? 0 : abi_ser.binary_to_variant( "ram_fees", data, abi_serializer_max_time )["unsettled"].as_int64();
+   }
+
+   fc::variant get_ram_market() {
+      vector<char> data = get_row_by_account( config::system_account_name, config::system_account_name, N(rammarket),
+                                              account_name(symbol(4, "RAMCORE").value()) );
+      return data.empty() ? fc::variant() : abi_ser.binary_to_variant( "exchange_state", data, abi_serializer_max_time );
+   }
+
+   fc::variant get_ram_price() {
+      vector<char> data = get_row_by_account( config::system_account_name, config::system_account_name, N(ramprice), N(ramprice) );
+      return data.empty() ? fc::variant() : abi_ser.binary_to_variant( "ram_price", data, abi_serializer_max_time );
    }
 
    fc::variant get_voter_info( const account_name& act ) {
@@ -585,6 +728,11 @@ public:
    abi_serializer token_abi_ser;
 };
 
+class eosio_system_activated_tester : public eosio_system_tester {
+public:
+   eosio_system_activated_tester() : eosio_system_tester( setup_level::activated ) {}
+};
+
 inline fc::mutable_variant_object voter( account_name acct ) {
    return mutable_variant_object()
       ("owner", acct)
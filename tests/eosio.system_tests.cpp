@@ -3,6 +3,7 @@
 #include <eosio/chain/global_property_object.hpp>
 #include <eosio/chain/resource_limits.hpp>
 #include <eosio/chain/wast_to_wasm.hpp>
+#include <cmath>
 #include <cstdlib>
 #include <iostream>
 #include <fc/log/logger.hpp>
@@ -18,6 +19,17 @@ FC_REFLECT( _abi_hash, (owner)(hash) );
 
 using namespace eosio_system;
 
+// same math as exchange_state::convert of ram into the core token through RAMCORE
+static asset sell_ram_quote( const fc::variant& market, int64_t bytes ) {
+   const double supply = market["supply"].as<asset>().get_amount();
+   const double base   = market["base"]["balance"].as<asset>().get_amount();
+   const double quote  = market["quote"]["balance"].as<asset>().get_amount();
+
+   const int64_t issued = int64_t( -supply * ( 1.0 - std::pow( 1.0 + bytes / (base + bytes), market["base"]["weight"].as_double() ) ) );
+   const int64_t out    = int64_t( quote * ( std::pow( 1.0 + issued / supply, 1.0 / market["quote"]["weight"].as_double() ) - 1.0 ) );
+   return asset( out, market["quote"]["balance"].as<asset>().get_symbol() );
+}
+
 BOOST_AUTO_TEST_SUITE(eosio_system_tests)
 
 BOOST_FIXTURE_TEST_CASE( buysell, eosio_system_tester ) try {
@@ -32,10 +44,21 @@ BOOST_FIXTURE_TEST_CASE( buysell, eosio_system_tester ) try {
 
    const asset initial_ram_balance = get_balance(N(eosio.ram));
    const asset initial_ramfee_balance = get_balance(N(eosio.ramfee));
+   const int64_t initial_unsettled_fees = get_unsettled_ram_fees();
    BOOST_REQUIRE_EQUAL( success(), buyram( "alice1111111", "alice1111111", core_sym::from_string("200.0000") ) );
    BOOST_REQUIRE_EQUAL( core_sym::from_string("800.0000"), get_balance( "alice1111111" ) );
-   BOOST_REQUIRE_EQUAL( initial_ram_balance + core_sym::from_string("199.0000"), get_balance(N(eosio.ram)) );
-   BOOST_REQUIRE_EQUAL( initial_ramfee_balance + core_sym::from_string("1.0000"), get_balance(N(eosio.ramfee)) );
+   // the fee is kept by eosio.ram until it is settled
+   BOOST_REQUIRE_EQUAL( initial_ram_balance + core_sym::from_string("200.0000"), get_balance(N(eosio.ram)) );
+   BOOST_REQUIRE_EQUAL( initial_ramfee_balance, get_balance(N(eosio.ramfee)) );
+   BOOST_REQUIRE_EQUAL( initial_unsettled_fees + core_sym::from_string("1.0000").get_amount(), get_unsettled_ram_fees() );
+
+   BOOST_REQUIRE_EQUAL( success(), push_action( N(bob111111111), N(settleramfee), mvo() ) );
+   BOOST_REQUIRE_EQUAL( initial_ram_balance + core_sym::from_string("199.0000") - asset( initial_unsettled_fees, symbol{CORE_SYM} ),
+                        get_balance(N(eosio.ram)) );
+   BOOST_REQUIRE_EQUAL( initial_ramfee_balance + core_sym::from_string("1.0000") + asset( initial_unsettled_fees, symbol{CORE_SYM} ),
+                        get_balance(N(eosio.ramfee)) );
+   BOOST_REQUIRE_EQUAL( 0, get_unsettled_ram_fees() );
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("no ram fees to settle"), push_action( N(bob111111111), N(settleramfee), mvo() ) );
 
    total = get_total_stake( "alice1111111" );
    auto bytes = total["ram_bytes"].as_uint64();
@@ -120,6 +143,92 @@ BOOST_FIXTURE_TEST_CASE( buysell, eosio_system_tester ) try {
 
 } FC_LOG_AND_RETHROW()
 
+BOOST_FIXTURE_TEST_CASE( buyrambytes_exact, eosio_system_tester ) try {
+   transfer( "eosio", "alice1111111", core_sym::from_string("100000.0000"), "eosio" );
+
+   for( uint32_t bytes : { 1u, 1000u, 1024u * 1024u } ) {
+      const uint64_t init_bytes = get_total_stake( "alice1111111" )["ram_bytes"].as_uint64();
+      const asset init_balance = get_balance( "alice1111111" );
+      const asset init_ram_balance = get_balance( N(eosio.ram) );
+      const int64_t init_unsettled_fees = get_unsettled_ram_fees();
+
+      auto trace = base_tester::push_action( config::system_account_name, N(buyrambytes), N(alice1111111), mvo()
+                                             ("payer",    "alice1111111")
+                                             ("receiver", "alice1111111")
+                                             ("bytes",    bytes)
+      );
+      produce_block();
+      const auto bytes_cpu = trace->receipt->cpu_usage_us;
+
+      // exactly the requested amount is bought, the fee is .5% of the total paid
+      BOOST_REQUIRE_EQUAL( init_bytes + bytes, get_total_stake( "alice1111111" )["ram_bytes"].as_uint64() );
+      const asset paid = init_balance - get_balance( "alice1111111" );
+      const int64_t fee = get_unsettled_ram_fees() - init_unsettled_fees;
+      BOOST_REQUIRE_EQUAL( paid, get_balance( N(eosio.ram) ) - init_ram_balance );
+      BOOST_REQUIRE_EQUAL( (paid.get_amount() - fee + 198) / 199, fee );
+
+      // buying ram with the same amount of tokens gives about the same number of bytes
+      trace = base_tester::push_action( config::system_account_name, N(buyram), N(alice1111111), mvo()
+                                        ("payer",    "alice1111111")
+                                        ("receiver", "alice1111111")
+                                        ("quant",    paid)
+      );
+      produce_block();
+      const auto quant_cpu = trace->receipt->cpu_usage_us;
+      const uint64_t quant_bytes = get_total_stake( "alice1111111" )["ram_bytes"].as_uint64() - init_bytes - bytes;
+      if( bytes > 1000 ) {
+         BOOST_REQUIRE( quant_bytes <= bytes );
+         BOOST_REQUIRE( bytes - quant_bytes <= bytes / 100 );
+      }
+
+      BOOST_TEST_MESSAGE( "buyrambytes " << bytes << " bytes for " << paid << ": " << bytes_cpu << " us, "
+                          << "buyram " << paid << " for " << quant_bytes << " bytes: " << quant_cpu << " us" );
+   }
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( ram_price_published, eosio_system_tester ) try {
+   transfer( "eosio", "alice1111111", core_sym::from_string("1000.0000"), "eosio" );
+   const auto init_price = get_ram_price();
+   BOOST_REQUIRE( !init_price.is_null() );
+
+   BOOST_REQUIRE_EQUAL( success(), buyram( "alice1111111", "alice1111111", core_sym::from_string("200.0000") ) );
+   auto price = get_ram_price();
+   BOOST_REQUIRE_EQUAL( sell_ram_quote( get_ram_market(), 1024 ), price["sell_price_per_kb"].as<asset>() );
+   BOOST_REQUIRE_EQUAL( init_price["volume"].as<asset>() + core_sym::from_string("199.0000"), price["volume"].as<asset>() );
+   BOOST_REQUIRE_EQUAL( control->pending_block_time(), price["last_trade"].as<block_timestamp_type>().to_time_point() );
+   const int64_t bought = price["volume_bytes"].as_int64() - init_price["volume_bytes"].as_int64();
+   BOOST_REQUIRE( 0 < bought );
+
+   // later trades of the same block requote too
+   BOOST_REQUIRE_EQUAL( success(), buyram( "alice1111111", "alice1111111", core_sym::from_string("10.0000") ) );
+   const auto same_block_price = get_ram_price();
+   BOOST_REQUIRE_EQUAL( sell_ram_quote( get_ram_market(), 1024 ), same_block_price["sell_price_per_kb"].as<asset>() );
+   const int64_t bought_same_block = same_block_price["volume_bytes"].as_int64() - price["volume_bytes"].as_int64();
+   BOOST_REQUIRE( 0 < bought_same_block );
+   produce_block();
+
+   // a higher demand raises the price
+   const asset init_sell_price_per_kb = price["sell_price_per_kb"].as<asset>();
+   BOOST_REQUIRE_EQUAL( success(), buyrambytes( "alice1111111", "alice1111111", 100 * 1024 ) );
+   price = get_ram_price();
+   BOOST_REQUIRE_EQUAL( sell_ram_quote( get_ram_market(), 1024 ), price["sell_price_per_kb"].as<asset>() );
+   BOOST_REQUIRE( init_sell_price_per_kb < price["sell_price_per_kb"].as<asset>() );
+   produce_block();
+
+   BOOST_REQUIRE_EQUAL( success(), sellram( "alice1111111", bought ) );
+   price = get_ram_price();
+   BOOST_REQUIRE_EQUAL( sell_ram_quote( get_ram_market(), 1024 ), price["sell_price_per_kb"].as<asset>() );
+   BOOST_REQUIRE_EQUAL( init_price["volume_bytes"].as_int64() + 2 * bought + bought_same_block + 100 * 1024, price["volume_bytes"].as_int64() );
+
+   // the volume window is reset after a day
+   produce_block( fc::days(1) );
+   BOOST_REQUIRE_EQUAL( success(), buyrambytes( "alice1111111", "alice1111111", 1024 ) );
+   price = get_ram_price();
+   BOOST_REQUIRE_EQUAL( 1024, price["volume_bytes"].as_int64() );
+   BOOST_REQUIRE_EQUAL( price["last_trade"].as_string(), price["window_start"].as_string() );
+
+} FC_LOG_AND_RETHROW()
+
 BOOST_FIXTURE_TEST_CASE( stake_unstake, eosio_system_tester ) try {
    cross_15_percent_threshold();
 
@@ -3343,23 +3452,24 @@ BOOST_FIXTURE_TEST_CASE( eosioram_ramusage, eosio_system_tester ) try {
 
 } FC_LOG_AND_RETHROW()
 
-BOOST_FIXTURE_TEST_CASE( ram_gift, eosio_system_tester ) try {
-   active_and_vote_producers();
-
+BOOST_FIXTURE_TEST_CASE( ram_gift, eosio_system_activated_tester ) try {
    auto rlm = control->get_resource_limits_manager();
    int64_t ram_bytes_orig, net_weight, cpu_weight;
    rlm.get_account_limits( N(alice1111111), ram_bytes_orig, net_weight, cpu_weight );
 
-   /*
-    * It seems impossible to write this test, because buyrambytes action doesn't give you exact amount of bytes requested
-    *
-   //check that it's possible to create account bying required_bytes(2724) + userres table(112) + userres row(160) - ram_gift_bytes(1400)
-   create_account_with_resources( N(abcdefghklmn), N(alice1111111), 2724 + 112 + 160 - 1400 );
+   //the ram an account needs is what a first account created the same way uses
+   transfer( "eosio", "alice1111111", core_sym::from_string("100.0000"), "eosio" );
+   create_account_with_resources( N(abcdefghijkl), N(alice1111111), 8000 );
+   const int64_t required_bytes = rlm.get_account_ram_usage( N(abcdefghijkl) );
+   const int64_t ram_gift_bytes = 1400;
 
-   //check that one byte less is not enough
-   BOOST_REQUIRE_THROW( create_account_with_resources( N(abcdefghklmn), N(alice1111111), 2724 + 112 + 160 - 1400 - 1 ),
+   //check that one byte less than required_bytes - ram_gift_bytes is not enough
+   BOOST_REQUIRE_THROW( create_account_with_resources( N(abcdefghklmn), N(alice1111111), required_bytes - ram_gift_bytes - 1 ),
                         ram_usage_exceeded );
-   */
+
+   //check that it's possible to create account buying required_bytes - ram_gift_bytes, buyrambytes buys exactly that
+   create_account_with_resources( N(abcdefghklmn), N(alice1111111), required_bytes - ram_gift_bytes );
+   BOOST_REQUIRE_EQUAL( required_bytes, rlm.get_account_ram_usage( N(abcdefghklmn) ) );
 
    //check that stake/unstake keeps the gift
    transfer( "eosio", "alice1111111", core_sym::from_string("1000.0000"), "eosio" );
@@ -3388,6 +3498,160 @@ BOOST_FIXTURE_TEST_CASE( ram_gift, eosio_system_tester ) try {
 
 } FC_LOG_AND_RETHROW()
 
+BOOST_FIXTURE_TEST_CASE( newaccount_without_resources_row, eosio_system_tester ) try {
+   const account_name a = N(lazyuser1111);
+   {
+      // newaccount applies zero limits, so the ram of the account is bought in the same transaction
+      signed_transaction trx;
+      trx.actions.emplace_back( vector<permission_level>{{config::system_account_name, config::active_name}},
+                                newaccount{
+                                   .creator  = config::system_account_name,
+                                   .name     = a,
+                                   .owner    = authority( get_public_key( a, "owner" ) ),
+                                   .active   = authority( get_public_key( a, "active" ) )
+                                });
+      trx.actions.emplace_back( get_action( config::system_account_name, N(buyrambytes), vector<permission_level>{{config::system_account_name, config::active_name}},
+                                            mvo()
+                                            ("payer", "eosio")
+                                            ("receiver", a)
+                                            ("bytes", 8000) )
+                              );
+      set_transaction_headers(trx);
+      trx.sign( get_private_key( config::system_account_name, "active" ), control->get_chain_id() );
+      push_transaction( trx );
+   }
+
+   // the row is created by buyrambytes rather than newaccount and holds no stake
+   BOOST_REQUIRE_EQUAL( false, get_row_by_account( config::system_account_name, a, N(userres), a ).empty() );
+   BOOST_REQUIRE_EQUAL( 8000, get_total_stake( a )["ram_bytes"].as_uint64() );
+   BOOST_REQUIRE_EQUAL( core_sym::from_string("0.0000"), get_total_stake( a )["net_weight"].as<asset>() );
+
+   // an account without stake is still not an unlimited one
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("only supports unlimited accounts"),
+                        push_action( config::system_account_name, N(setalimits), mvo()
+                                     ("account", a)
+                                     ("ram_bytes", 5000)
+                                     ("net_weight", 0)
+                                     ("cpu_weight", 0) )
+   );
+
+   // the first stake is added to the row
+   transfer( "eosio", "alice1111111", core_sym::from_string("1000.0000"), "eosio" );
+   BOOST_REQUIRE_EQUAL( success(), stake( "alice1111111", a, core_sym::from_string("10.0000"), core_sym::from_string("20.0000") ) );
+   BOOST_REQUIRE_EQUAL( core_sym::from_string("10.0000"), get_total_stake( a )["net_weight"].as<asset>() );
+   auto rlm = control->get_resource_limits_manager();
+   int64_t ram_bytes, net_weight, cpu_weight;
+   rlm.get_account_limits( a, ram_bytes, net_weight, cpu_weight );
+   BOOST_REQUIRE_EQUAL( 8000 + 1400, ram_bytes );
+   BOOST_REQUIRE_EQUAL( 100000, net_weight );
+   BOOST_REQUIRE_EQUAL( 200000, cpu_weight );
+
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("only supports unlimited accounts"),
+                        push_action( config::system_account_name, N(setalimits), mvo()
+                                     ("account", a)
+                                     ("ram_bytes", 6000)
+                                     ("net_weight", 0)
+                                     ("cpu_weight", 0) )
+   );
+
+   // accounts created before the system contract keep working
+   BOOST_REQUIRE_EQUAL( success(), push_action( config::system_account_name, N(setalimits), mvo()
+                                                ("account", "eosio.vpay")
+                                                ("ram_bytes", -1)
+                                                ("net_weight", -1)
+                                                ("cpu_weight", -1) )
+   );
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( onboard, eosio_system_tester ) try {
+   const std::vector<account_name> accounts = { N(onboard11111), N(onboard22222), N(onboard33333) };
+   const uint32_t ram_bytes = 3000;
+   const asset net = core_sym::from_string("1.0000");
+   const asset cpu = core_sym::from_string("2.0000");
+
+   transfer( "eosio", "alice1111111", core_sym::from_string("1000.0000"), "eosio" );
+
+   auto make_accounts = [&]( const std::vector<account_name>& names ) {
+      fc::variants v;
+      for( const auto& a : names ) {
+         v.push_back( mvo()
+                      ("account",   a)
+                      ("owner",     authority( get_public_key( a, "owner" ) ))
+                      ("active",    authority( get_public_key( a, "active" ) ))
+                      ("ram_bytes", ram_bytes)
+                      ("stake_net", net)
+                      ("stake_cpu", cpu)
+         );
+      }
+      return v;
+   };
+
+   const asset initial_alice_balance  = get_balance( "alice1111111" );
+   const asset initial_ram_balance    = get_balance( N(eosio.ram) );
+   const int64_t initial_unsettled    = get_unsettled_ram_fees();
+   const asset initial_stake_balance  = get_balance( N(eosio.stake) );
+   const uint64_t initial_reserved    = get_global_state()["total_ram_bytes_reserved"].as_uint64();
+
+   BOOST_REQUIRE_EQUAL( success(), push_action( N(alice1111111), N(onboard), mvo()
+                                                ("creator",  "alice1111111")
+                                                ("accounts", make_accounts( accounts ))
+                        )
+   );
+
+   // one trade and one transfer per destination for the whole batch, the ram fee is kept by eosio.ram
+   const asset ram_paid = get_balance( N(eosio.ram) ) - initial_ram_balance;
+   const int64_t fee    = get_unsettled_ram_fees() - initial_unsettled;
+   const asset staked   = get_balance( N(eosio.stake) ) - initial_stake_balance;
+   BOOST_REQUIRE_EQUAL( core_sym::from_string("9.0000"), staked );
+   BOOST_REQUIRE( fee < ram_paid.get_amount() );
+   BOOST_REQUIRE_EQUAL( (ram_paid.get_amount() - fee + 198) / 199, fee );
+   BOOST_REQUIRE_EQUAL( initial_alice_balance - ram_paid - staked, get_balance( "alice1111111" ) );
+   BOOST_REQUIRE_EQUAL( initial_reserved + accounts.size() * ram_bytes, get_global_state()["total_ram_bytes_reserved"].as_uint64() );
+   BOOST_REQUIRE_EQUAL( staked.get_amount(), get_voter_info( "alice1111111" )["staked"].as_int64() );
+
+   auto rlm = control->get_resource_limits_manager();
+   for( const auto& a : accounts ) {
+      BOOST_REQUIRE( control->db().find<account_object,by_name>( a ) != nullptr );
+
+      auto total = get_total_stake( a );
+      BOOST_REQUIRE_EQUAL( ram_bytes, total["ram_bytes"].as_uint64() );
+      BOOST_REQUIRE_EQUAL( net, total["net_weight"].as<asset>() );
+      BOOST_REQUIRE_EQUAL( cpu, total["cpu_weight"].as<asset>() );
+
+      int64_t ram, net_weight, cpu_weight;
+      rlm.get_account_limits( a, ram, net_weight, cpu_weight );
+      BOOST_REQUIRE_EQUAL( ram_bytes + 1400, ram );
+      BOOST_REQUIRE_EQUAL( net.get_amount(), net_weight );
+      BOOST_REQUIRE_EQUAL( cpu.get_amount(), cpu_weight );
+   }
+
+   // stake is delegated by the creator, like delegatebw without transfer
+   for( const auto& a : accounts ) {
+      BOOST_REQUIRE_EQUAL( false, get_row_by_account( config::system_account_name, N(alice1111111), N(delband), a ).empty() );
+   }
+
+   // created accounts can use their resources
+   transfer( "eosio", "onboard22222", core_sym::from_string("10.0000"), "eosio" );
+   BOOST_REQUIRE_EQUAL( success(), buyram( "onboard22222", "onboard22222", core_sym::from_string("1.0000") ) );
+
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("account already exists"),
+                        push_action( N(alice1111111), N(onboard), mvo()
+                                     ("creator",  "alice1111111")
+                                     ("accounts", make_accounts( { N(onboard44444), N(onboard22222) } ))
+                        )
+   );
+
+   // zero stake is accepted, a negative one is not
+   auto negative = make_accounts( { N(onboard44444) } );
+   negative[0] = mvo( negative[0].get_object() )("stake_net", core_sym::from_string("-1.0000"));
+   BOOST_REQUIRE_EQUAL( wasm_assert_msg("must not stake a negative amount"),
+                        push_action( N(alice1111111), N(onboard), mvo()
+                                     ("creator",  "alice1111111")
+                                     ("accounts", negative)
+                        )
+   );
+} FC_LOG_AND_RETHROW()
+
 BOOST_FIXTURE_TEST_CASE( setabi_bios, TESTER ) try {
    abi_serializer abi_ser(fc::json::from_string( (const char*)contracts::system_abi().data()).template as<abi_def>(), abi_serializer_max_time);
    set_code( config::system_account_name, contracts::bios_wasm() );
@@ -0,0 +1,295 @@
+#include <boost/test/unit_test.hpp>
+#include <eosio/chain/contract_table_objects.hpp>
+#include <eosio/chain/global_property_object.hpp>
+#include <eosio/chain/resource_limits.hpp>
+#include <eosio/chain/wast_to_wasm.hpp>
+#include <cstdlib>
+#include <iostream>
+#include <fc/log/logger.hpp>
+#include <eosio/chain/exceptions.hpp>
+#include <Runtime/Runtime.h>
+
+#include "eosio.benchmark_tester.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <random>
+
+using namespace eosio_system;
+
+namespace {
+
+/**
+ * Settings of the search, read from the environment
+ */
+struct worst_case_config {
+   uint32_t iterations = env_uint( "WORST_CASE_ITERATIONS", 20 ); ///< mutations tried per scenario
+   uint32_t repeats    = env_uint( "WORST_CASE_REPEATS", 3 );     ///< runs per input, the cheapest one is kept to filter out noise
+   uint32_t seed       = env_uint( "WORST_CASE_SEED", 1 );
+};
+
+/**
+ * Input of a scenario which the search varies between 'min' and 'max'
+ */
+struct worst_case_param {
+   std::string name;
+   uint32_t    min;
+   uint32_t    max;
+};
+
+/**
+ * Builds the chain state described by the values of its parameters on a fresh chain and measures the action
+ */
+struct worst_case_scenario {
+   std::string                   action;
+   std::vector<worst_case_param> params;
+   std::function<void( eosio_benchmark_tester&, const std::string&, const std::vector<uint32_t>& )> run;
+};
+
+std::vector<account_name> generated_accounts( const std::string& prefix, uint32_t count ) {
+   std::vector<account_name> accounts;
+   for( uint32_t i = 0; i < count; ++i ) {
+      accounts.push_back( eosio_benchmark_tester::generated_account( prefix, i ) );
+   }
+   return accounts;
+}
+
+/// 'count' accounts starting at 'first', sorted as voteproducer requires
+std::vector<account_name> window( const std::vector<account_name>& accounts, size_t first, size_t count ) {
+   std::vector<account_name> result;
+   for( size_t i = 0; i < std::min( count, accounts.size() ); ++i ) {
+      result.push_back( accounts[( first + i ) % accounts.size()] );
+   }
+   std::sort( result.begin(), result.end() );
+   return result;
+}
+
+std::vector<account_name> register_producers( eosio_benchmark_tester& t, uint32_t count ) {
+   auto producers = generated_accounts( "wprd", count );
+   t.create_staked_accounts( producers, core_sym::from_string("10.0000") );
+   t.push_batched( producers, N(regproducer), [&]( size_t j ) {
+      return mvo()("producer", producers[j])("producer_key", t.get_public_key( producers[j], "active" ))
+                  ("url", "https://" + producers[j].to_string() + ".example")("location", 0);
+   });
+   return producers;
+}
+
+/// stakes and votes with more than 15% of the supply so that the producers are elected
+void activate( eosio_benchmark_tester& t, const std::vector<account_name>& producers ) {
+   t.transfer( "eosio", "alice1111111", core_sym::from_string("300000000.0000"), "eosio" );
+   BOOST_REQUIRE_EQUAL( t.success(), t.stake( "alice1111111", "alice1111111", core_sym::from_string("100000000.0000"), core_sym::from_string("100000000.0000") ) );
+   BOOST_REQUIRE_EQUAL( t.success(), t.push_action( N(alice1111111), N(voteproducer), mvo()
+                                                    ("voter", "alice1111111")("proxy", name(0))("producers", window( producers, 0, 30 )) ) );
+   t.produce_blocks( 250 );
+}
+
+std::vector<worst_case_scenario> scenarios() {
+   std::vector<worst_case_scenario> result;
+
+   // a voter, or a proxy, replacing its previous votes
+   result.push_back({ "eosio::voteproducer",
+      { { "producers", 1, 30 }, { "previous_producers", 0, 30 }, { "previous_shift", 0, 59 }, { "is_proxy", 0, 1 } },
+      []( eosio_benchmark_tester& t, const std::string& scenario, const std::vector<uint32_t>& v ) {
+         const auto producers = register_producers( t, 60 );
+         const account_name voter = eosio_benchmark_tester::generated_account( "wvtr", 0 );
+         t.create_staked_accounts( { voter }, core_sym::from_string("10.0000") );
+         if( v[3] ) {
+            BOOST_REQUIRE_EQUAL( t.success(), t.push_action( voter, N(regproxy), mvo()("proxy", voter)("isproxy", true) ) );
+         }
+         if( v[1] ) {
+            BOOST_REQUIRE_EQUAL( t.success(), t.push_action( voter, N(voteproducer), mvo()
+                                                             ("voter", voter)("proxy", name(0))("producers", window( producers, v[2], v[1] )) ) );
+         }
+         t.produce_block();
+         t.measure( scenario, config::system_account_name, N(voteproducer), voter, mvo()
+                    ("voter", voter)("proxy", name(0))("producers", window( producers, 0, v[0] )) );
+      }
+   });
+
+   // a voter proxied to a proxy, whose votes for every producer of the proxy are updated
+   result.push_back({ "eosio::delegatebw",
+      { { "proxy_producers", 1, 30 }, { "other_receiver", 0, 1 } },
+      []( eosio_benchmark_tester& t, const std::string& scenario, const std::vector<uint32_t>& v ) {
+         const auto producers = register_producers( t, 30 );
+         const account_name proxy = eosio_benchmark_tester::generated_account( "wprx", 0 );
+         const account_name voter = eosio_benchmark_tester::generated_account( "wvtr", 0 );
+         t.create_staked_accounts( { proxy, voter }, core_sym::from_string("10.0000") );
+         BOOST_REQUIRE_EQUAL( t.success(), t.push_action( proxy, N(regproxy), mvo()("proxy", proxy)("isproxy", true) ) );
+         BOOST_REQUIRE_EQUAL( t.success(), t.push_action( proxy, N(voteproducer), mvo()
+                                                          ("voter", proxy)("proxy", name(0))("producers", window( producers, 0, v[0] )) ) );
+         BOOST_REQUIRE_EQUAL( t.success(), t.push_action( voter, N(voteproducer), mvo()
+                                                          ("voter", voter)("proxy", proxy)("producers", vector<account_name>()) ) );
+         t.transfer( "eosio", voter, core_sym::from_string("100.0000"), "eosio" );
+         t.produce_block();
+         t.measure( scenario, config::system_account_name, N(delegatebw), voter, mvo()
+                    ("from", voter)("receiver", v[1] ? N(bob111111111) : voter)
+                    ("stake_net_quantity", core_sym::from_string("10.0000"))("stake_cpu_quantity", core_sym::from_string("10.0000"))
+                    ("transfer", 0) );
+      }
+   });
+
+   // a proposal whose actions are authorized by many approvers
+   result.push_back({ "eosio.msig::exec",
+      { { "approvals", 1, 100 }, { "actions", 1, 20 }, { "immediate", 0, 1 } },
+      []( eosio_benchmark_tester& t, const std::string& scenario, const std::vector<uint32_t>& v ) {
+         const auto approvers = generated_accounts( "wapr", v[0] );
+         t.create_staked_accounts( approvers, core_sym::from_string("10.0000") );
+         for( size_t i = 0; i < approvers.size(); ++i ) {
+            t.transfer( "eosio", approvers[i], core_sym::from_string("1.0000"), "eosio" );
+            if( i % 20 == 19 ) t.produce_block();
+         }
+         t.initialize_multisig();
+         if( t.profiled_contracts.count( config::system_account_name ) ) {
+            t.profile_contract( N(eosio.msig) );
+         }
+
+         const uint32_t actions = std::min( v[1], v[0] );
+         transaction trx;
+         trx.expiration = t.control->head_block_time() + fc::hours(1);
+         vector<permission_level> requested;
+         for( uint32_t k = 0; k < actions; ++k ) {
+            vector<permission_level> auths;
+            for( size_t j = k; j < approvers.size(); j += actions ) {
+               auths.push_back( { approvers[j], config::active_name } );
+            }
+            requested.insert( requested.end(), auths.begin(), auths.end() );
+            trx.actions.push_back( t.get_action( N(eosio.token), N(transfer), auths, mvo()
+                                                 ("from", approvers[k])("to", "alice1111111")
+                                                 ("quantity", core_sym::from_string("0.0001"))("memo", "") ) );
+         }
+
+         t.base_tester::push_action( N(eosio.msig), N(propose), N(alice1111111), mvo()
+                                     ("proposer", "alice1111111")("proposal_name", "worst")("trx", trx)("requested", requested) );
+         for( size_t i = 0; i < approvers.size(); ++i ) {
+            t.base_tester::push_action( N(eosio.msig), N(approve), approvers[i], mvo()
+                                        ("proposer", "alice1111111")("proposal_name", "worst")
+                                        ("level", permission_level{ approvers[i], config::active_name }) );
+            if( i % 20 == 19 ) t.produce_block();
+         }
+         t.produce_block();
+         t.measure( scenario, N(eosio.msig), N(exec), N(bob111111111), mvo()
+                    ("proposer", "alice1111111")("proposal_name", "worst")("executer", "bob111111111")("immediate", bool(v[2])) );
+      }
+   });
+
+   // the first block after 14 days of activation, which closes a name auction and updates the producer schedule
+   result.push_back({ "eosio::onblock",
+      { { "producers", 21, 60 }, { "bids", 1, 30 } },
+      []( eosio_benchmark_tester& t, const std::string& scenario, const std::vector<uint32_t>& v ) {
+         const auto producers = register_producers( t, v[0] );
+         activate( t, producers );
+         for( const auto& newname : generated_accounts( "wbid", v[1] ) ) {
+            BOOST_REQUIRE_EQUAL( t.success(), t.bidname( N(alice1111111), newname, core_sym::from_string("1.0000") ) );
+         }
+         t.produce_block();
+         t.measure_onblock( scenario, fc::days(14) );
+      }
+   });
+
+   return result;
+}
+
+std::string describe( const worst_case_scenario& s, const std::vector<uint32_t>& values ) {
+   std::string result;
+   for( size_t i = 0; i < s.params.size(); ++i ) {
+      result += ( i ? " " : "" ) + s.params[i].name + "=" + std::to_string( values[i] );
+   }
+   return result;
+}
+
+/// wasm instructions executed by the scenario on a chain with profiled contracts, which do not vary between runs
+action_cost profile( const worst_case_scenario& s, const std::vector<uint32_t>& values ) {
+   eosio_benchmark_tester t;
+   t.profile_contract( N(eosio.token) );
+   t.profile_contract( config::system_account_name );
+   s.run( t, describe( s, values ), values );
+   BOOST_REQUIRE( !t.costs.empty() );
+   return t.costs.back();
+}
+
+/// billed cpu, or the elapsed time of onblock which is not billed
+uint32_t time_us( const action_cost& cost ) {
+   return cost.elapsed_us ? cost.elapsed_us : cost.cpu_usage_us;
+}
+
+/// cheapest of 'repeats' runs with the contracts as deployed, each on a chain restored from the snapshot cache
+action_cost measure_cpu( const worst_case_scenario& s, const std::vector<uint32_t>& values, uint32_t repeats ) {
+   action_cost cheapest;
+   for( uint32_t r = 0; r < repeats; ++r ) {
+      eosio_benchmark_tester t;
+      s.run( t, describe( s, values ), values );
+      BOOST_REQUIRE( !t.costs.empty() );
+      if( r == 0 || time_us( t.costs.back() ) < time_us( cheapest ) ) {
+         cheapest = t.costs.back();
+      }
+   }
+   return cheapest;
+}
+
+} /// namespace
+
+BOOST_AUTO_TEST_SUITE(eosio_worst_case_tests)
+
+// Searches for the inputs and chain state which maximize the cost of each scenario. The search starts with every
+// parameter at its maximum and tries WORST_CASE_ITERATIONS random changes of one parameter, keeping those which
+// execute more wasm instructions in the profiled contracts; unlike the billed cpu the counts are the same on every
+// run, so small differences are not lost in noise. The cpu of the worst inputs found is then measured with the
+// contracts as deployed. Only runs when EOSIO_WORST_CASE_TESTS is set; the worst inputs are written to the file in
+// WORST_CASE_REPORT when it is set.
+BOOST_AUTO_TEST_CASE( worst_case_cpu, * boost::unit_test::precondition( env_is_set{ "EOSIO_WORST_CASE_TESTS" } ) ) try {
+   const worst_case_config cfg;
+   BOOST_REQUIRE( cfg.repeats > 0 );
+   std::mt19937 rng( cfg.seed );
+
+   uint32_t max_transaction_cpu_usage = 0;
+   fc::variants report;
+   for( const auto& s : scenarios() ) {
+      std::vector<uint32_t> best_values;
+      for( const auto& p : s.params ) {
+         best_values.push_back( p.max );
+      }
+      action_cost profiled = profile( s, best_values );
+
+      for( uint32_t i = 0; i < cfg.iterations; ++i ) {
+         auto values = best_values;
+         const size_t index = std::uniform_int_distribution<size_t>( 0, s.params.size() - 1 )( rng );
+         values[index] = std::uniform_int_distribution<uint32_t>( s.params[index].min, s.params[index].max )( rng );
+         if( values == best_values ) continue;
+
+         const action_cost cost = profile( s, values );
+         if( cost.instructions > profiled.instructions ) {
+            best_values = values;
+            profiled    = cost;
+         }
+      }
+
+      action_cost worst = measure_cpu( s, best_values, cfg.repeats );
+      worst.instructions = profiled.instructions;
+      worst.functions    = profiled.functions;
+      worst.intrinsics   = profiled.intrinsics;
+
+      if( !max_transaction_cpu_usage ) {
+         eosio_benchmark_tester t;
+         max_transaction_cpu_usage = t.control->get_global_properties().configuration.max_transaction_cpu_usage;
+      }
+      BOOST_TEST_MESSAGE( s.action << ": " << worst.instructions << " instructions, " << time_us( worst )
+                          << ( worst.elapsed_us ? " us elapsed" : " us billed" ) << " of " << max_transaction_cpu_usage
+                          << " us with " << worst.scenario );
+
+      mutable_variant_object inputs;
+      for( size_t i = 0; i < s.params.size(); ++i ) {
+         inputs( s.params[i].name, best_values[i] );
+      }
+      report.push_back( mvo()
+                        ("action", s.action)
+                        ("inputs", inputs)
+                        ("cost",   worst)
+                        ("max_transaction_cpu_usage", max_transaction_cpu_usage) );
+   }
+
+   if( const char* path = std::getenv( "WORST_CASE_REPORT" ) ) {
+      fc::json::save_to_file( report, path, true );
+   }
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -111,12 +111,39 @@ public:
 
    transaction wrap_exec( account_name executer, const transaction& trx, uint32_t expiration = base_tester::DEFAULT_EXPIRATION_DELTA );
 
+   transaction wrap_execinline( account_name executer, const transaction& trx, uint32_t expiration = base_tester::DEFAULT_EXPIRATION_DELTA );
+
+   transaction wrap_execbatch( account_name executer, const vector<transaction>& trxs, uint32_t expiration = base_tester::DEFAULT_EXPIRATION_DELTA );
+
+   transaction wrap_action( account_name executer, action_name act_name, const variant_object& data, uint32_t expiration );
+
+   transaction_trace_ptr push_signed_by_producers( const transaction& trx, account_name executer ) {
+      signed_transaction strx( trx, {}, {} );
+      strx.sign( get_private_key( executer, "active" ), control->get_chain_id() );
+      for( const auto& actor : {"prod1", "prod2", "prod3", "prod4"} ) {
+         strx.sign( get_private_key( actor, "active" ), control->get_chain_id() );
+      }
+      return push_transaction( strx );
+   }
+
    transaction reqauth( account_name from, const vector<permission_level>& auths, uint32_t expiration = base_tester::DEFAULT_EXPIRATION_DELTA );
 
    abi_serializer abi_ser;
 };
 
 transaction eosio_wrap_tester::wrap_exec( account_name executer, const transaction& trx, uint32_t expiration ) {
+   return wrap_action( executer, N(exec), fc::mutable_variant_object()("executer", executer)("trx", trx), expiration );
+}
+
+transaction eosio_wrap_tester::wrap_execinline( account_name executer, const transaction& trx, uint32_t expiration ) {
+   return wrap_action( executer, N(execinline), fc::mutable_variant_object()("executer", executer)("trx", trx), expiration );
+}
+
+transaction eosio_wrap_tester::wrap_execbatch( account_name executer, const vector<transaction>& trxs, uint32_t expiration ) {
+   return wrap_action( executer, N(execbatch), fc::mutable_variant_object()("executer", executer)("trxs", trxs), expiration );
+}
+
+transaction eosio_wrap_tester::wrap_action( account_name executer, action_name act_name, const variant_object& data, uint32_t expiration ) {
    fc::variants v;
    v.push_back( fc::mutable_variant_object()
                   ("actor", executer)
@@ -128,9 +155,9 @@ transaction eosio_wrap_tester::wrap_exec( account_name executer, const transacti
              );
    auto act_obj = fc::mutable_variant_object()
                      ("account", "eosio.wrap")
-                     ("name", "exec")
+                     ("name", act_name)
                      ("authorization", v)
-                     ("data", fc::mutable_variant_object()("executer", executer)("trx", trx) );
+                     ("data", data );
    transaction trx2;
    set_transaction_headers(trx2, expiration);
    action act;
@@ -357,4 +384,99 @@ BOOST_FIXTURE_TEST_CASE( wrap_with_msig_producers_change, eosio_wrap_tester ) tr
 
 } FC_LOG_AND_RETHROW()
 
+BOOST_FIXTURE_TEST_CASE( wrap_execinline_direct, eosio_wrap_tester ) try {
+   auto trx = reqauth( N(bob), {permission_level{N(bob), config::active_name}} );
+
+   transaction_trace_ptr scheduled_trace;
+   control->applied_transaction.connect([&]( const transaction_trace_ptr& t) { if (t->scheduled) { scheduled_trace = t; } } );
+
+   auto trace = push_signed_by_producers( wrap_execinline( N(alice), trx ), N(alice) );
+
+   produce_block();
+
+   // the wrapped action is executed within the same transaction
+   BOOST_REQUIRE( !scheduled_trace );
+   BOOST_REQUIRE_EQUAL( transaction_receipt::executed, trace->receipt->status );
+   BOOST_REQUIRE_EQUAL( 1, trace->action_traces.size() );
+   BOOST_REQUIRE_EQUAL( "execinline", name{trace->action_traces[0].act.name} );
+   BOOST_REQUIRE_EQUAL( 1, trace->action_traces[0].inline_traces.size() );
+   BOOST_REQUIRE_EQUAL( "eosio", name{trace->action_traces[0].inline_traces[0].act.account} );
+   BOOST_REQUIRE_EQUAL( "reqauth", name{trace->action_traces[0].inline_traces[0].act.name} );
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( wrap_execinline_with_delay, eosio_wrap_tester ) try {
+   auto trx = reqauth( N(bob), {permission_level{N(bob), config::active_name}} );
+   trx.delay_sec = 10;
+
+   BOOST_REQUIRE_EXCEPTION( push_signed_by_producers( wrap_execinline( N(alice), trx ), N(alice) ),
+                            eosio_assert_message_exception,
+                            eosio_assert_message_is("inline execution requires a transaction without delay")
+   );
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( wrap_execbatch_direct, eosio_wrap_tester ) try {
+   vector<transaction> trxs = { reqauth( N(bob), {permission_level{N(bob), config::active_name}} ),
+                                reqauth( N(carol), {permission_level{N(carol), config::active_name}} ) };
+
+   transaction_trace_ptr scheduled_trace;
+   control->applied_transaction.connect([&]( const transaction_trace_ptr& t) { if (t->scheduled) { scheduled_trace = t; } } );
+
+   auto trace = push_signed_by_producers( wrap_execbatch( N(alice), trxs ), N(alice) );
+
+   produce_block();
+
+   BOOST_REQUIRE( !scheduled_trace );
+   BOOST_REQUIRE_EQUAL( transaction_receipt::executed, trace->receipt->status );
+   BOOST_REQUIRE_EQUAL( 1, trace->action_traces.size() );
+   const auto& inline_traces = trace->action_traces[0].inline_traces;
+   BOOST_REQUIRE_EQUAL( 2, inline_traces.size() );
+   BOOST_REQUIRE_EQUAL( "reqauth", name{inline_traces[0].act.name} );
+   BOOST_REQUIRE_EQUAL( "reqauth", name{inline_traces[1].act.name} );
+   BOOST_REQUIRE_EQUAL( "bob", inline_traces[0].act.authorization[0].actor.to_string() );
+   BOOST_REQUIRE_EQUAL( "carol", inline_traces[1].act.authorization[0].actor.to_string() );
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( wrap_execinline_with_msig, eosio_wrap_tester ) try {
+   auto trx = reqauth( N(bob), {permission_level{N(bob), config::active_name}} );
+   auto wrap_trx = wrap_execinline( N(alice), trx );
+
+   propose( N(carol), N(first),
+            { {N(alice), N(active)},
+              {N(prod1), N(active)}, {N(prod2), N(active)}, {N(prod3), N(active)}, {N(prod4), N(active)}, {N(prod5), N(active)} },
+            wrap_trx );
+
+   approve( N(carol), N(first), N(alice) );
+   approve( N(carol), N(first), N(prod1) );
+   approve( N(carol), N(first), N(prod2) );
+   approve( N(carol), N(first), N(prod3) );
+   approve( N(carol), N(first), N(prod4) );
+
+   vector<transaction_trace_ptr> traces;
+   control->applied_transaction.connect([&]( const transaction_trace_ptr& t) {
+      if (t->scheduled) {
+         traces.push_back( t );
+      }
+   } );
+
+   push_action( N(eosio.msig), N(exec), N(alice), mvo()
+                  ("proposer",      "carol")
+                  ("proposal_name", "first")
+                  ("executer",      "alice")
+   );
+
+   produce_block();
+
+   // only the msig proposal is deferred, the wrapped action runs inline within it
+   BOOST_REQUIRE_EQUAL( 1, traces.size() );
+   BOOST_REQUIRE_EQUAL( transaction_receipt::executed, traces[0]->receipt->status );
+   BOOST_REQUIRE_EQUAL( 1, traces[0]->action_traces.size() );
+   BOOST_REQUIRE_EQUAL( "execinline", name{traces[0]->action_traces[0].act.name} );
+   BOOST_REQUIRE_EQUAL( 1, traces[0]->action_traces[0].inline_traces.size() );
+   BOOST_REQUIRE_EQUAL( "reqauth", name{traces[0]->action_traces[0].inline_traces[0].act.name} );
+
+} FC_LOG_AND_RETHROW()
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -33,6 +33,14 @@ boost::unit_test::test_suite* init_unit_test_suite(int argc, char* argv[]) {
    }
    if(!is_verbose) fc::logger::get(DEFAULT_LOGGER).set_log_level(fc::log_level::off);
 
+   // Rebuild the chain of every fixture instead of restoring the snapshot of its setup level
+   for (int i = 0; i < argc; i++) {
+      if (std::string("--no-snapshot-cache") == argv[i]) {
+         eosio_system_tester::snapshot_cache_enabled() = false;
+         break;
+      }
+   }
+
    // Register fc::exception translator
    boost::unit_test::unit_test_monitor.template register_exception_translator<fc::exception>(&translate_fc_exception);
 